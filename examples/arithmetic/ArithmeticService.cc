@@ -4,37 +4,29 @@
 using namespace goa::rpc;
 
 // CRTP设计模式
+// 各个method在哪个线程中执行由spec.json中的execution决定, 这里只需要同步地完成计算
 class ArithmeticService : public ArithmeticServiceStub<ArithmeticService> {
  public:
   explicit ArithmeticService(RpcServer& server)
-      : ArithmeticServiceStub(server), pool_(4) {}
+      : ArithmeticServiceStub(server) {}
 
   void Add(double lhs, double rhs, const UserDoneCallback& callback) {
-    pool_.runTask([=]() {
-      // 在这里处理lhs和rhs参数，之后交给UserDoneCallback，其会将result发送给客户端
-      goa::json::Value result =
-          goa::json::Value(static_cast<double>(lhs + rhs));
-      callback(std::move(result));
-    });
+    // 在这里处理lhs和rhs参数，之后交给UserDoneCallback，其会将result发送给客户端
+    goa::json::Value result = goa::json::Value(static_cast<double>(lhs + rhs));
+    callback(std::move(result));
   }
 
   void Sub(double lhs, double rhs, const UserDoneCallback& callback) {
-    pool_.runTask(
-        [=]() { callback(goa::json::Value(static_cast<double>(lhs - rhs))); });
+    callback(goa::json::Value(static_cast<double>(lhs - rhs)));
   }
 
   void Mul(double lhs, double rhs, const UserDoneCallback& callback) {
-    pool_.runTask(
-        [=]() { callback(goa::json::Value(static_cast<double>(lhs * rhs))); });
+    callback(goa::json::Value(static_cast<double>(lhs * rhs)));
   }
 
   void Div(double lhs, double rhs, const UserDoneCallback& callback) {
-    pool_.runTask(
-        [=]() { callback(goa::json::Value(static_cast<double>(lhs / rhs))); });
+    callback(goa::json::Value(static_cast<double>(lhs / rhs)));
   }
-
- private:
-  ThreadPool pool_;
 };  // ArithmeticServer
 
 int main() {
@@ -48,6 +40,7 @@ int main() {
   InetAddress addr(9877);
 
   RpcServer rpcServer(&loop, addr);
+  rpcServer.setWorkerThreads(4);  // execution为shared的method
   ArithmeticService service(rpcServer);
 
   rpcServer.start();
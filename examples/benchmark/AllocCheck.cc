@@ -0,0 +1,183 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+
+#include "examples/benchmark/EchoServiceStub.hpp"
+#include "goa-ev/src/Logger.hpp"
+#include "server/RpcServer.hpp"
+#include "utils/FrameDecoder.hpp"
+#include "utils/FrameWriter.hpp"
+
+using namespace goa::rpc;
+
+// 与bench_server相同, Echo在IO线程中直接返回
+class EchoService : public EchoServiceStub<EchoService> {
+ public:
+  explicit EchoService(RpcServer& server) : EchoServiceStub(server) {}
+
+  void Echo(double value, const UserDoneCallback& callback) {
+    callback(goa::json::Value(value));
+  }
+};
+
+// 检查request的热路径在稳定状态下不分配内存: 与BaseServer::handleMessage相同,
+// 连接的输入buffer中的帧经FrameDecoder拆出, 交给已start()的RpcServer::handleRequest,
+// 经过envelope扫描、method分发和typed codec的Echo, response按sendResponse的方式序列化进输出buffer
+// 预热之后替换的operator new记录到任何一次分配即失败, 作为ctest的alloc_check运行
+
+namespace {
+
+std::atomic<bool> counting(false);
+std::atomic<long> allocations(0);
+
+void* countedAlloc(size_t size) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+  if (counting.load(std::memory_order_relaxed)) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  auto alignment = static_cast<size_t>(align);
+  void* ptr =
+      aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+// 一次读到的帧数, 与客户端流水线发送时一次读到多个request相同
+const int kFramesPerRead = 16;
+const size_t kMaxMessageLen = 64 * 1024;
+
+// 客户端发送的一帧, 在开始计数之前序列化好, 之后只是拷贝进输入buffer, 相当于从socket读入
+std::string makeFrame() {
+  goa::json::Value params(goa::json::ValueType::TYPE_OBJECT);
+  params.addMember("value", 1.5);
+  goa::json::Value call(goa::json::ValueType::TYPE_OBJECT);
+  call.addMember("jsonrpc", "2.0");
+  call.addMember("method", "Echo.Echo");
+  call.addMember("params", params);
+  call.addMember("id", 1);
+  Buffer buf;
+  appendFrame(buf, FramingMode::BINARY, CodecId::JSON, call);
+  return buf.retrieveAllAsString();
+}
+
+struct Stats {
+  long responses = 0;
+  long errors = 0;
+};
+
+// 读到一批帧并全部分发, response追加到output, 之后取走, 相当于写入socket
+void runReads(long reads, RpcServer& server, const std::string& frame,
+              FrameDecoder& decoder, Buffer& input, Buffer& output,
+              Stats& stats) {
+  for (long i = 0; i < reads; i++) {
+    for (int j = 0; j < kFramesPerRead; j++) {
+      input.append(frame.data(), frame.size());
+    }
+    auto received = Deadline::Clock::now();
+    while (true) {
+      auto status = decoder.decode(input);
+      if (status != FrameDecoder::Status::FRAME) {
+        if (status == FrameDecoder::Status::ERROR) stats.errors++;
+        break;
+      }
+      server.handleRequest(
+          decoder.body(input), decoder.codec(), received,
+          [&output, &stats](const RpcResponse& response) {
+            size_t begin = output.readableBytes();
+            appendFrame(output, FramingMode::BINARY, CodecId::JSON, response);
+            std::string_view written(output.peek() + begin,
+                                     output.readableBytes() - begin);
+            if (written.find("\"result\"") == std::string_view::npos) {
+              stats.errors++;
+            }
+            stats.responses++;
+          });
+      decoder.consume(input);
+    }
+    output.retrieveAll();
+  }
+}
+
+void usage() {
+  std::cerr << "usage: alloc_check [-n reads]\n";
+  exit(1);
+}
+
+}  // anonymous namespace
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, std::align_val_t align) {
+  return countedAlignedAlloc(size, align);
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+  free(ptr);
+}
+
+int main(int argc, char** argv) {
+  long reads = 100000;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+      case 'n':
+        reads = atol(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (reads <= 0) usage();
+
+  goa::ev::setLogLevel(goa::ev::LOG_LEVEL::LOG_LEVEL_WARN);
+
+  // server不会收到连接, 只是按handleMessage的方式直接分发帧
+  EventLoop loop;
+  RpcServer server(&loop, InetAddress(0, true));
+  EchoService service(server);
+  server.start();
+
+  auto frame = makeFrame();
+  FrameDecoder decoder(kMaxMessageLen);
+  Buffer input;
+  Buffer output;
+  Stats stats;
+
+  // 预热: 输入输出buffer和各thread_local的buffer扩容到稳定大小
+  const long warmupReads = 64;
+  runReads(warmupReads, server, frame, decoder, input, output, stats);
+  long warmupResponses = stats.responses;
+
+  counting = true;
+  runReads(reads, server, frame, decoder, input, output, stats);
+  counting = false;
+
+  long requests = reads * kFramesPerRead;
+  long responses = stats.responses - warmupResponses;
+  std::cout << "requests: " << requests << ", responses: " << responses
+            << ", allocations: " << allocations.load() << "\n";
+  if (responses != requests || stats.errors != 0) {
+    std::cerr << "alloc_check: lost or failed responses\n";
+    return 1;
+  }
+  if (allocations.load() != 0) {
+    std::cerr << "alloc_check: steady-state request path allocated memory\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "examples/benchmark/EchoClientStub.hpp"
+#include "goa-ev/src/Logger.hpp"
+
+using namespace goa::rpc;
+
+/*
+分别以TCP回环、Unix domain socket和共享内存连接bench_server, 比较几种传输方式:
+  ./bench_server -p 9878 &   ./bench_client -p 9878
+  ./bench_server -u /tmp/goa-rpc.sock &   ./bench_client -u /tmp/goa-rpc.sock
+  ./bench_server -s /tmp/goa-rpc-shm.sock &   ./bench_client -s /tmp/goa-rpc-shm.sock
+-d为流水线深度, 即同时在途的请求数, 为1时测得的是单次调用的往返延迟
+-b使用二进制分帧, -m使用MessagePack编码(同时使用二进制分帧)
+*/
+static void usage() {
+  std::cerr << "usage: bench_client [-p port] [-u unix_socket_path] "
+               "[-s shm_socket_path] [-n calls] [-d depth] [-b] [-m]\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  uint16_t port = 9878;
+  const char* unixPath = nullptr;
+  const char* shmPath = nullptr;
+  long total = 100000;
+  long depth = 1;
+  bool binary = false;
+  bool msgpack = false;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:u:s:n:d:bm")) != -1) {
+    switch (opt) {
+      case 'p':
+        port = static_cast<uint16_t>(atoi(optarg));
+        break;
+      case 'u':
+        unixPath = optarg;
+        break;
+      case 's':
+        shmPath = optarg;
+        break;
+      case 'n':
+        total = atol(optarg);
+        break;
+      case 'd':
+        depth = atol(optarg);
+        break;
+      case 'b':
+        binary = true;
+        break;
+      case 'm':
+        msgpack = true;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (total <= 0 || depth <= 0) usage();
+
+  goa::ev::setLogLevel(goa::ev::LOG_LEVEL::LOG_LEVEL_WARN);
+
+  EventLoop loop;
+  std::unique_ptr<EchoClientStub> client;
+  if (shmPath != nullptr) {
+    client = std::make_unique<EchoClientStub>(&loop, ShmAddress(shmPath));
+  } else if (unixPath != nullptr) {
+    client = std::make_unique<EchoClientStub>(&loop, UnixAddress(unixPath));
+  } else {
+    client = std::make_unique<EchoClientStub>(&loop, InetAddress(port, true));
+  }
+  if (binary) client->setFramingMode(FramingMode::BINARY);
+  if (msgpack) client->setCodec(CodecId::MSGPACK);
+
+  long sent = 0;
+  long received = 0;
+  auto begin = std::chrono::steady_clock::now();
+
+  // 每收到一个response就补发一个request, 保持depth个请求在途
+  std::function<void()> call = [&]() {
+    sent++;
+    client->Echo(static_cast<double>(sent),
+                 [&](const goa::json::Value&, bool isError, bool) {
+                   if (isError) {
+                     std::cerr << "echo error" << std::endl;
+                     loop.quit();
+                     return;
+                   }
+                   if (++received == total) {
+                     loop.quit();
+                   } else if (sent < total) {
+                     call();
+                   }
+                 });
+  };
+
+  client->setConnectionCallback([&](const TcpConnectionPtr& conn) {
+    if (conn->disconnected()) {
+      loop.quit();
+      return;
+    }
+    begin = std::chrono::steady_clock::now();
+    for (long i = 0; i < depth && sent < total; i++) {
+      call();
+    }
+  });
+  client->start();
+  loop.loop();
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - begin;
+  double seconds = elapsed.count();
+  const char* transport = shmPath != nullptr    ? "shm"
+                          : unixPath != nullptr ? "unix"
+                                                : "tcp";
+  std::cout << transport << " "
+            << (binary ? "binary" : "text") << " framing: " << received
+            << " calls, depth " << depth << ", " << seconds << "s, "
+            << static_cast<double>(received) / seconds << " calls/s, "
+            << seconds * 1e6 * static_cast<double>(depth) /
+                   static_cast<double>(received)
+            << " us/call" << std::endl;
+}
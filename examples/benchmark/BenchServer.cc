@@ -0,0 +1,94 @@
+#include <unistd.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "examples/benchmark/EchoServiceStub.hpp"
+#include "server/ShardedRpcServer.hpp"
+#include "goa-ev/src/Logger.hpp"
+
+using namespace goa::rpc;
+
+// Echo直接在IO线程中返回, 测得的是框架本身(传输、分帧、分发)的开销
+class EchoService : public EchoServiceStub<EchoService> {
+ public:
+  explicit EchoService(RpcServer& server) : EchoServiceStub(server) {}
+
+  void Echo(double value, const UserDoneCallback& callback) {
+    callback(goa::json::Value(value));
+  }
+};
+
+static void usage() {
+  std::cerr << "usage: bench_server [-p port] [-u unix_socket_path] "
+               "[-s shm_socket_path] [-r shards] [-i]\n";
+  exit(1);
+}
+
+int main(int argc, char** argv) {
+  uint16_t port = 9878;
+  const char* unixPath = nullptr;
+  const char* shmPath = nullptr;
+  long shards = 0;
+  auto backend = IoBackend::EPOLL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "p:u:s:r:i")) != -1) {
+    switch (opt) {
+      case 'p':
+        port = static_cast<uint16_t>(atoi(optarg));
+        break;
+      case 'u':
+        unixPath = optarg;
+        break;
+      case 's':
+        shmPath = optarg;
+        break;
+      case 'r':
+        shards = atol(optarg);
+        break;
+      case 'i':
+        backend = IoBackend::IO_URING;
+        break;
+      default:
+        usage();
+    }
+  }
+
+  goa::ev::setLogLevel(goa::ev::LOG_LEVEL::LOG_LEVEL_WARN);
+
+  EventLoop loop;
+
+  // -r: 多个SO_REUSEPORT的shard, 每个shard一个线程和一份EchoService
+  if (shards > 0) {
+    std::vector<std::unique_ptr<EchoService>> services(
+        static_cast<size_t>(shards));
+    ShardedRpcServer shardedServer(
+        InetAddress(port), static_cast<size_t>(shards),
+        [&services](RpcServer& server, size_t index) {
+          services[index] = std::make_unique<EchoService>(server);
+        });
+    shardedServer.setIoBackend(backend);
+    shardedServer.start();
+    loop.loop();
+    return 0;
+  }
+
+  std::unique_ptr<RpcServer> rpcServer;
+  if (shmPath != nullptr) {
+    rpcServer = std::make_unique<RpcServer>(&loop, ShmAddress(shmPath));
+  } else if (unixPath != nullptr) {
+    rpcServer = std::make_unique<RpcServer>(&loop, UnixAddress(unixPath));
+  } else if (backend == IoBackend::IO_URING) {
+    rpcServer = std::make_unique<RpcServer>(&loop, InetAddress(port), true,
+                                            IoBackend::IO_URING);
+  } else {
+    rpcServer = std::make_unique<RpcServer>(&loop, InetAddress(port));
+  }
+  EchoService service(*rpcServer);
+
+  rpcServer->start();
+  loop.loop();
+}
@@ -0,0 +1,159 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "utils/WorkStealingExecutor.hpp"
+#include "utils/utils.hpp"
+
+using namespace goa::rpc;
+
+// 多个service负载不均时比较几种线程池的用法: 每个service各自的ThreadPool(与ArithmeticService原来的用法相同),
+// 所有service共用一个ThreadPool, 以及RpcServer共享的WorkStealingExecutor
+// 总线程数相同, 第0个service收到skew%的任务, 其余任务平均分给其他service, 每个任务忙等work纳秒
+
+namespace {
+
+struct Options {
+  size_t threads = 8;
+  size_t services = 4;
+  long tasks = 200000;
+  long workNs = 2000;
+  long skew = 70;
+  bool affinity = false;
+};
+
+void spin(long ns) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+// 确定的任务序列, 各种实现收到的负载相同
+std::vector<size_t> makeSchedule(const Options& options) {
+  std::vector<size_t> schedule(static_cast<size_t>(options.tasks));
+  uint64_t state = 88172645463325252ULL;
+  for (auto& service : schedule) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    auto percent = static_cast<long>(state % 100);
+    service = percent < options.skew || options.services == 1
+                  ? 0
+                  : 1 + state / 100 % (options.services - 1);
+  }
+  return schedule;
+}
+
+template <typename Submit>
+void run(const char* name, const std::vector<size_t>& schedule, long workNs,
+         Submit&& submit) {
+  std::atomic<long> remaining(static_cast<long>(schedule.size()));
+  auto start = std::chrono::steady_clock::now();
+  for (size_t service : schedule) {
+    submit(service, [&remaining, workNs]() {
+      spin(workNs);
+      remaining.fetch_sub(1, std::memory_order_release);
+    });
+  }
+  while (remaining.load(std::memory_order_acquire) > 0) {
+    std::this_thread::yield();
+  }
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << name << ": " << elapsed.count() << " ms, "
+            << static_cast<double>(schedule.size()) / elapsed.count() * 1000
+            << " tasks/s\n";
+}
+
+void usage() {
+  std::cerr << "usage: bench_executor [-t threads] [-s services] [-n tasks] "
+               "[-w work_ns] [-k skew_percent] [-a]\n";
+  exit(1);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:s:n:w:k:a")) != -1) {
+    switch (opt) {
+      case 't':
+        options.threads = static_cast<size_t>(atol(optarg));
+        break;
+      case 's':
+        options.services = static_cast<size_t>(atol(optarg));
+        break;
+      case 'n':
+        options.tasks = atol(optarg);
+        break;
+      case 'w':
+        options.workNs = atol(optarg);
+        break;
+      case 'k':
+        options.skew = atol(optarg);
+        break;
+      case 'a':
+        options.affinity = true;
+        break;
+      default:
+        usage();
+    }
+  }
+  if (options.threads == 0 || options.services == 0 || options.tasks <= 0 ||
+      options.workNs < 0 || options.skew < 0 || options.skew > 100) {
+    usage();
+  }
+
+  goa::ev::setLogLevel(goa::ev::LOG_LEVEL::LOG_LEVEL_WARN);
+
+  auto schedule = makeSchedule(options);
+  // 与WorkStealingExecutor相同的队列上限, 提交不会因为队列满而阻塞
+  auto maxQueueSize = static_cast<size_t>(options.tasks);
+  std::cout << "threads: " << options.threads
+            << ", services: " << options.services
+            << ", tasks: " << options.tasks << ", work: " << options.workNs
+            << " ns, skew: " << options.skew << "%\n";
+
+  {
+    size_t perService = std::max<size_t>(1, options.threads / options.services);
+    std::vector<std::unique_ptr<ThreadPool>> pools;
+    for (size_t i = 0; i < options.services; i++) {
+      pools.push_back(std::make_unique<ThreadPool>(perService, maxQueueSize));
+    }
+    run("ThreadPool per service", schedule, options.workNs,
+        [&pools](size_t service, WorkStealingExecutor::Task task) {
+          pools[service]->runTask(std::move(task));
+        });
+  }
+
+  {
+    ThreadPool pool(options.threads, maxQueueSize);
+    run("shared ThreadPool", schedule, options.workNs,
+        [&pool](size_t, WorkStealingExecutor::Task task) {
+          pool.runTask(std::move(task));
+        });
+  }
+
+  {
+    std::vector<int> cpus;
+    if (options.affinity) {
+      auto numCpus = std::max(1u, std::thread::hardware_concurrency());
+      for (size_t i = 0; i < options.threads; i++) {
+        cpus.push_back(static_cast<int>(i % numCpus));
+      }
+    }
+    WorkStealingExecutor executor(options.threads, cpus);
+    run("WorkStealingExecutor", schedule, options.workNs,
+        [&executor](size_t, WorkStealingExecutor::Task task) {
+          executor.runTask(std::move(task));
+        });
+  }
+}
@@ -0,0 +1,137 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "utils/FrameDecoder.hpp"
+#include "utils/FrameWriter.hpp"
+#include "utils/SimdScan.hpp"
+
+using namespace goa::rpc;
+
+// 拆包的microbenchmark: 一个buffer中有n个流水线的文本帧, 比较逐帧找header和解析长度的几种实现
+// baseline为memchr + 逐字节解析, 与SimdScan之前FrameDecoder的实现相同
+// 下一帧的位置取决于本帧的长度, 各实现的差别主要在这条依赖链的长度上
+
+namespace {
+
+const char* kBody = R"({"jsonrpc":"2.0","method":"Echo.Echo","params":{"value":1.0},"id":1})";
+
+uint64_t scanBaseline(const std::string& data) {
+  uint64_t frames = 0;
+  const char* p = data.data();
+  const char* end = p + data.size();
+  while (p < end) {
+    auto lf = static_cast<const char*>(
+        memchr(p, '\n', static_cast<size_t>(end - p)));
+    if (lf == nullptr) break;
+    const char* q = p;
+    while (q < lf - 1 && *q == ' ') ++q;
+    uint64_t length = 0;
+    while (q < lf - 1 && *q >= '0' && *q <= '9') {
+      length = length * 10 + static_cast<uint64_t>(*q - '0');
+      ++q;
+    }
+    p = lf + 1 + length;
+    frames++;
+  }
+  return frames;
+}
+
+uint64_t scanGeneric(const std::string& data) {
+  uint64_t frames = 0;
+  const char* p = data.data();
+  const char* end = p + data.size();
+  while (p < end) {
+    const char* lf = findByte(p, std::min(end, p + 34), '\n');
+    if (lf == nullptr) break;
+    uint64_t length = 0;
+    if (!parseTextLength(p, lf - 1, &length)) break;
+    p = lf + 1 + length;
+    frames++;
+  }
+  return frames;
+}
+
+uint64_t scanFixed(const std::string& data) {
+  uint64_t frames = 0;
+  const char* p = data.data();
+  const char* end = p + data.size();
+  while (end - p >= 16) {
+    uint64_t length = 0;
+    if (!parseFixedTextHeader(p, &length)) break;
+    p += kTextHeaderLen + length;
+    frames++;
+  }
+  return frames;
+}
+
+// 完整的FrameDecoder, 包括Buffer的拷贝
+uint64_t decodeAll(const std::string& data) {
+  Buffer buf;
+  buf.append(data.data(), data.size());
+  FrameDecoder decoder(100 * 1024 * 1024);
+  uint64_t frames = 0;
+  while (decoder.decode(buf) == FrameDecoder::Status::FRAME) {
+    decoder.consume(buf);
+    frames++;
+  }
+  return frames;
+}
+
+template <typename Func>
+void run(const char* name, const std::string& data, int rounds, Func&& func) {
+  uint64_t frames = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++) frames += func(data);
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << name << ": " << elapsed.count() / static_cast<double>(frames)
+            << " ns/frame\n";
+}
+
+void usage() {
+  std::cerr << "usage: bench_frame [-n frames] [-r rounds]\n";
+  exit(1);
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  long n = 1000;
+  long rounds = 1000;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+    switch (opt) {
+      case 'n':
+        n = atol(optarg);
+        break;
+      case 'r':
+        rounds = atol(optarg);
+        break;
+      default:
+        usage();
+    }
+  }
+  if (n <= 0 || rounds <= 0) usage();
+
+  Buffer buf;
+  goa::json::Document body;
+  body.parse(kBody, strlen(kBody));
+  for (long i = 0; i < n; i++) {
+    appendFrame(buf, FramingMode::TEXT, CodecId::JSON, body);
+  }
+  std::string data(buf.peek(), buf.readableBytes());
+
+  std::cout << "frames: " << n << ", bytes: " << data.size()
+            << ", scanner: " << simdScanImpl() << "\n";
+  run("memchr + loop", data, static_cast<int>(rounds), scanBaseline);
+  run("findByte + parseTextLength", data, static_cast<int>(rounds),
+      scanGeneric);
+  run("parseFixedTextHeader", data, static_cast<int>(rounds), scanFixed);
+  run("FrameDecoder", data, static_cast<int>(rounds), decodeAll);
+}
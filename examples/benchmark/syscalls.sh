@@ -0,0 +1,28 @@
+#!/bin/sh
+# 统计bench_server在epoll和io_uring两种IO方式下每个请求的系统调用次数, 需要strace
+# 用法: ./syscalls.sh [bin目录] [请求数] [流水线深度]
+BIN=${1:-./bin}
+CALLS=${2:-100000}
+DEPTH=${3:-16}
+PORT=9879
+OUT=/tmp/goa-rpc-syscalls.$$
+
+run() {
+    "$BIN"/bench_server -p $PORT $2 &
+    server=$!
+    sleep 0.5
+    strace -c -f -p $server -o $OUT &
+    tracer=$!
+    sleep 0.5
+    "$BIN"/bench_client -p $PORT -n "$CALLS" -d "$DEPTH"
+    kill -INT $tracer
+    wait $tracer
+    kill $server
+    wait $server 2>/dev/null
+    total=$(awk '$NF == "total" { print $4 }' $OUT)
+    echo "$1: $total syscalls, $(echo "scale=3; $total / $CALLS" | bc) per call"
+    rm -f $OUT
+}
+
+run epoll ""
+run io_uring "-i"
@@ -1,14 +1,17 @@
 #include "client/BaseClient.hpp"
 
+#include <cassert>
 #include <cstddef>
 #include <functional>
 #include <string>
 
 #include "goa-json/include/Document.hpp"
 #include "goa-json/include/Exception.hpp"
-#include "goa-json/include/StringWriteStream.hpp"
-#include "goa-json/include/Writer.hpp"
+#include "transport/ShmClient.hpp"
+#include "transport/UnixClient.hpp"
+#include "utils/Codec.hpp"
 #include "utils/Exception.hpp"
+#include "utils/FrameWriter.hpp"
 #include "utils/RpcError.hpp"
 
 namespace goa {
@@ -43,14 +46,60 @@ json::Value& findValue(json::Value& value, const char* key,
 }  // anonymous namespace
 
 BaseClient::BaseClient(EventLoop* loop, const InetAddress& serverAddr)
-    : id_(0), client_(loop, serverAddr) {
-  client_.setMessageCallback(std::bind(&BaseClient::onMessage, this, _1, _2));
+    : id_(0),
+      decoder_(kMaxMessageLen, FramingMode::TEXT),
+      tcpClient_(std::make_unique<TcpClient>(loop, serverAddr)) {
+  tcpClient_->setMessageCallback(
+      std::bind(&BaseClient::onMessage, this, _1, _2));
 }
 
-void BaseClient::start() { client_.start(); }
+BaseClient::BaseClient(EventLoop* loop, const UnixAddress& serverAddr)
+    : id_(0),
+      decoder_(kMaxMessageLen, FramingMode::TEXT),
+      unixClient_(std::make_unique<UnixClient>(loop, serverAddr)) {
+  unixClient_->setMessageCallback(
+      std::bind(&BaseClient::onMessage, this, _1, _2));
+}
+
+BaseClient::BaseClient(EventLoop* loop, const ShmAddress& serverAddr)
+    : id_(0),
+      decoder_(kMaxMessageLen, FramingMode::TEXT),
+      shmClient_(std::make_unique<ShmClient>(loop, serverAddr)) {
+  shmClient_->setMessageCallback(
+      std::bind(&BaseClient::onMessage, this, _1, _2));
+}
+
+BaseClient::~BaseClient() = default;
+
+void BaseClient::start() {
+  if (tcpClient_) {
+    tcpClient_->start();
+  } else if (unixClient_) {
+    unixClient_->start();
+  } else {
+    shmClient_->start();
+  }
+}
 
 void BaseClient::setConnectionCallback(const ConnectionCallback& callback) {
-  client_.setConnectionCallback(callback);
+  if (tcpClient_) {
+    tcpClient_->setConnectionCallback(callback);
+  } else if (unixClient_) {
+    unixClient_->setConnectionCallback(callback);
+  } else {
+    shmClient_->setConnectionCallback(callback);
+  }
+}
+
+void BaseClient::setFramingMode(FramingMode mode) {
+  assert(mode != FramingMode::UNKNOWN);
+  assert(mode == FramingMode::BINARY || decoder_.codec() == CodecId::JSON);
+  decoder_.setMode(mode);
+}
+
+void BaseClient::setCodec(CodecId codec) {
+  if (codec != CodecId::JSON) decoder_.setMode(FramingMode::BINARY);
+  decoder_.setCodec(codec);
 }
 
 //  带回调处理函数的request发送
@@ -68,21 +117,19 @@ void BaseClient::sendNotify(const TcpConnectionPtr& conn, json::Value& notify) {
 
 void BaseClient::sendRequest(const TcpConnectionPtr& conn,
                              json::Value& request) {
-  json::StringWriteStream os;
-  json::Writer writer(os);
-  request.writeTo(writer);  // json格式的request 序列化为string
-
-  /* message有header和body两部分组成
-header: body的长度
-body: response + crlf分隔符
-
-内存分布：header + "\r\n" + body + "\r\n"
-*/
-  auto message = std::to_string(os.getStringView().length() + 2)
-                     .append("\r\n")
-                     .append(os.getStringView())
-                     .append("\r\n");
-  conn->send(message);
+  if (timeout_.count() > 0) {
+    request.addMember("timeout", static_cast<int64_t>(timeout_.count()));
+  }
+  // request直接序列化进buffer, header回填, 分帧方式见utils/Frame.hpp
+  thread_local Buffer buf;
+  appendFrame(buf, decoder_.mode(), decoder_.codec(), request);
+  // 共享内存连接中conn只是控制连接, 数据经过共享内存发送
+  if (shmClient_) {
+    shmClient_->send(buf);
+  } else {
+    conn->send(buf);
+  }
+  buf.retrieveAll();  // 连接已断开时send不会取走数据
 }
 
 // 处理收到的response
@@ -107,37 +154,31 @@ void BaseClient::onMessage(const TcpConnectionPtr& conn, Buffer& buf) {
 
 void BaseClient::handleMessage(Buffer& buf) {
   while (true) {
-    auto crlf = buf.findCRLF();
-    if (crlf == nullptr) break;
-
-    size_t headerLen =
-        static_cast<size_t>(crlf - buf.peek() + 2);  // bodyLength + "\r\n"
-    json::Document header;
-    auto err = header.parse(buf.peek(), headerLen);  // 反序列化header
-    if (err != json::ParseError::PARSE_OK || !header.isInt32() ||
-        header.getInt32() <= 0) {
-      buf.retrieve(headerLen);
-      throw ResponseException("invalid message length in header");
+    auto status = decoder_.decode(buf);
+    if (status == FrameDecoder::Status::INCOMPLETE)
+      break;  // 不完整的帧留在buf中, 下次onMessage时继续
+    if (status == FrameDecoder::Status::ERROR) {
+      // 出错后无法再确定帧边界, 丢弃已收到的所有数据
+      buf.retrieveAll();
+      decoder_.reset();
+      throw ResponseException(decoder_.error());
     }
 
-    auto bodyLen = static_cast<uint32_t>(header.getInt32());
-    if (bodyLen >= kMaxMessageLen) {
-      throw ResponseException("message is too long");
+    // body直接在buf中原地解析, 处理完后再取走
+    try {
+      handleResponse(decoder_.body(buf));  // body交由下层继续处理，这里只负责拆包逻辑
+    } catch (...) {
+      decoder_.consume(buf);
+      throw;
     }
-
-    if (buf.readableBytes() < headerLen + bodyLen)
-      break;  // message实际长度小于header中记录的长度，直接丢弃，做报废处理
-    buf.retrieve(headerLen);
-    auto json = buf.retrieveAsString(bodyLen);
-    handleResponse(json);  // body交由下层继续处理，这里只负责拆包逻辑
+    decoder_.consume(buf);
   }
 }
 
-void BaseClient::handleResponse(std::string& json) {
+void BaseClient::handleResponse(std::string_view body) {
   json::Document response;  //反序列化body
-  auto err = response.parse(json);
-  if (err != json::ParseError::PARSE_OK) {
-    throw ResponseException(json::parseErrorString(err));
+  if (const char* err = parseBody(decoder_.codec(), body, response)) {
+    throw ResponseException(err);
   }
 
   switch (response.getType()) {
@@ -1,28 +1,50 @@
 #pragma once
 
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <string_view>
 #include <goa-json/include/Value.hpp>
 #include <unordered_map>
 
 #include "goa-ev/src/Buffer.hpp"
 #include "goa-ev/src/Callbacks.hpp"
+#include "transport/ShmAddress.hpp"
+#include "transport/UnixAddress.hpp"
+#include "utils/Frame.hpp"
+#include "utils/FrameDecoder.hpp"
 #include "utils/utils.hpp"
 
 namespace goa {
 
 namespace rpc {
 
+class UnixClient;
+class ShmClient;
+
 using ResponseCallback =
     std::function<void(const json::Value& json, bool isError, bool isTimeout)>;
 
 class BaseClient : noncopyable {
  public:
   BaseClient(EventLoop* loop, const InetAddress& serverAddr);
+  BaseClient(EventLoop* loop, const UnixAddress& serverAddr);
+  BaseClient(EventLoop* loop, const ShmAddress& serverAddr);
+  ~BaseClient();
 
   void start();
 
   void setConnectionCallback(const ConnectionCallback& callback);
 
+  // 在start()之前设置, 服务端根据第一帧自动使用相同的分帧方式, 默认为TEXT
+  void setFramingMode(FramingMode mode);
+  // 在start()之前设置, 服务端根据第一帧使用相同的编码方式, 默认为JSON
+  // JSON以外的编码方式只能用于BINARY分帧, 因此会同时切换为BINARY
+  void setCodec(CodecId codec);
+  // 之后发送的request和notify都带上timeout字段, 服务端在超时后不再调用method, 而是回复错误
+  // 0(默认)表示不带timeout
+  void setTimeout(std::chrono::milliseconds timeout) { timeout_ = timeout; }
+
   void sendCall(const TcpConnectionPtr& conn, json::Value& call,
                 const ResponseCallback& callback);
 
@@ -31,7 +53,7 @@ class BaseClient : noncopyable {
  private:
   void onMessage(const TcpConnectionPtr& conn, Buffer& buf);
   void handleMessage(Buffer& buf);
-  void handleResponse(std::string& json);
+  void handleResponse(std::string_view body);
   void handleSingleResponse(json::Value& response);
   void validateResponse(json::Value& response);
   void sendRequest(const TcpConnectionPtr& conn, json::Value& request);
@@ -39,8 +61,13 @@ class BaseClient : noncopyable {
  private:
   using Callbacks = std::unordered_map<int64_t, ResponseCallback>;
   int64_t id_;
+  std::chrono::milliseconds timeout_{0};
+  FrameDecoder decoder_;  // response的拆包状态, 跨多次onMessage保留
   Callbacks callbacks_;  // request得到response后，执行id对应的callback
-  TcpClient client_;
+  // 三者只有一个非空, 取决于服务端的地址类型
+  std::unique_ptr<TcpClient> tcpClient_;
+  std::unique_ptr<UnixClient> unixClient_;
+  std::unique_ptr<ShmClient> shmClient_;
 };
 
 }  // namespace rpc
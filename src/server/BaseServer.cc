@@ -2,25 +2,77 @@
 
 #include <cstdint>
 #include <functional>
-#include <goa-json/include/Document.hpp>
-#include <goa-json/include/StringWriteStream.hpp>
-#include <goa-json/include/Writer.hpp>
+#include <mutex>
+#include <utility>
 
 #include "goa-ev/src/Logger.hpp"
 #include "goa-json/include/Exception.hpp"
 #include "goa-json/include/Value.hpp"
+#include "server/ConnectionContext.hpp"
 #include "server/RpcServer.hpp"
+#include "transport/ReusePortServer.hpp"
+#include "transport/ShmServer.hpp"
+#include "transport/UnixServer.hpp"
+#ifdef GOA_RPC_IO_URING
+#include "transport/IoUring.hpp"
+#include "transport/UringServer.hpp"
+#endif
 #include "utils/Exception.hpp"
+#include "utils/Frame.hpp"
+#include "utils/FrameWriter.hpp"
+#include "utils/ObjectPool.hpp"
 #include "utils/RpcError.hpp"
 #include "utils/utils.hpp"
 namespace goa {
 namespace rpc {
 
+#ifndef GOA_RPC_IO_URING
+// 未启用io_uring时uringServer_始终为空, 只需要一个完整类型以便析构unique_ptr
+class UringServer : noncopyable {};
+#endif
+
 namespace {
 
-const size_t kHighWaterMark = 65536;
 const size_t kMaxMessageLen = 100 * 1024 * 1024;
 
+// HTTP request与response一一对应, 而notify没有response, done不会被调用
+// done的所有副本都析构时若仍未回复, 则回复204 No Content
+class HttpExchange : noncopyable {
+ public:
+  // 捕获conn、seq、keepAlive和server
+  using Reply = InlineFunction<void(const RpcResponse* response), 48>;
+
+  explicit HttpExchange(Reply reply) : reply_(std::move(reply)) {}
+  ~HttpExchange() {
+    if (!replied_) reply_(nullptr);
+  }
+
+  void reply(const RpcResponse& response) {
+    replied_ = true;
+    reply_(&response);
+  }
+
+ private:
+  Reply reply_;
+  bool replied_ = false;
+};
+
+bool concurrencyExhausted(const FlowControl& flowControl, size_t requests) {
+  return flowControl.maxInflightRequests != 0 &&
+         requests >= flowControl.maxInflightRequests;
+}
+
+// 超过字节数上限时暂停读, 降到一半以下时恢复
+bool creditExhausted(const FlowControl& flowControl, size_t bytes) {
+  return flowControl.maxInflightBytes != 0 &&
+         bytes >= flowControl.maxInflightBytes;
+}
+
+bool creditRecovered(const FlowControl& flowControl, size_t bytes) {
+  return flowControl.maxInflightBytes == 0 ||
+         bytes <= flowControl.maxInflightBytes / 2;
+}
+
 }  // anonymous namespace
 
 using std::placeholders::_1;
@@ -31,24 +83,133 @@ template class BaseServer<RpcServer>;
 template <typename ProtocolServer>
 BaseServer<ProtocolServer>::BaseServer(EventLoop* loop,
                                        const InetAddress& local)
-    : server_(loop, local) {
-  server_.setConnectionCallback(std::bind(&BaseServer::onConnection, this, _1));
-  server_.setMessageCallback(std::bind(&BaseServer::onMessage, this, _1, _2));
-  server_.setWriteCompleteCallback(
+    : tcpServer_(std::make_unique<TcpServer>(loop, local)) {
+  bindCallbacks(*tcpServer_);
+}
+
+template <typename ProtocolServer>
+BaseServer<ProtocolServer>::BaseServer(EventLoop* loop,
+                                       const InetAddress& local,
+                                       bool reusePort, IoBackend backend) {
+  if (backend == IoBackend::IO_URING) {
+#ifdef GOA_RPC_IO_URING
+    if (IoUring::supported()) {
+      uringServer_ = std::make_unique<UringServer>(loop, local);
+      uringServer_->setConnectionCallback(
+          std::bind(&BaseServer::onUringConnection, this, _1, _2));
+      uringServer_->setMessageCallback(
+          std::bind(&BaseServer::onMessage, this, _1, _2));
+      return;
+    }
+    WARN("BaseServer: io_uring is not supported by kernel, fall back to epoll");
+#else
+    WARN("BaseServer: built without io_uring, fall back to epoll");
+#endif
+    reusePort = true;  // 与io_uring一样只使用loop一个线程
+  }
+
+  if (reusePort) {
+    reusePortServer_ = std::make_unique<ReusePortServer>(loop, local);
+    bindCallbacks(*reusePortServer_);
+  } else {
+    tcpServer_ = std::make_unique<TcpServer>(loop, local);
+    bindCallbacks(*tcpServer_);
+  }
+}
+
+template <typename ProtocolServer>
+BaseServer<ProtocolServer>::BaseServer(EventLoop* loop,
+                                       const UnixAddress& local)
+    : unixServer_(std::make_unique<UnixServer>(loop, local)) {
+  bindCallbacks(*unixServer_);
+}
+
+template <typename ProtocolServer>
+BaseServer<ProtocolServer>::BaseServer(EventLoop* loop, const ShmAddress& local)
+    : shmServer_(std::make_unique<ShmServer>(loop, local)) {
+  shmServer_->setConnectionCallback(
+      std::bind(&BaseServer::onShmConnection, this, _1, _2));
+  shmServer_->setMessageCallback(
+      std::bind(&BaseServer::onMessage, this, _1, _2));
+}
+
+// 定义在此处, 各transport的server为完整类型
+template <typename ProtocolServer>
+BaseServer<ProtocolServer>::~BaseServer() = default;
+
+template <typename ProtocolServer>
+template <typename Server>
+void BaseServer<ProtocolServer>::bindCallbacks(Server& server) {
+  server.setConnectionCallback(std::bind(&BaseServer::onConnection, this, _1));
+  server.setMessageCallback(std::bind(&BaseServer::onMessage, this, _1, _2));
+  server.setWriteCompleteCallback(
       std::bind(&BaseServer::onWriteComplete, this, _1));
 }
 
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::setNumThreads(int numThreads) {
+  if (tcpServer_) {
+    tcpServer_->setNumThread(numThreads);
+  } else {
+    WARN("BaseServer::setNumThreads() ignored, only TcpServer has io threads");
+  }
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::start() {
+  if (tcpServer_) {
+    tcpServer_->start();
+  } else if (reusePortServer_) {
+    reusePortServer_->start();
+  } else if (uringServer_) {
+#ifdef GOA_RPC_IO_URING
+    uringServer_->start();
+#endif
+  } else if (unixServer_) {
+    unixServer_->start();
+  } else {
+    shmServer_->start();
+  }
+}
+
 template <typename ProtocolServer>
 void BaseServer<ProtocolServer>::onConnection(const TcpConnectionPtr& conn) {
   if (conn->connected()) {
     INFO("connection {} success", conn->peer().toIpPort());
-    conn->setHighWaterMarkCallback(
-        std::bind(&BaseServer::onHighWaterMark, this, _1, _2), kHighWaterMark);
+    conn->setContext(std::make_shared<ConnectionContext>(kMaxMessageLen));
+    if (flowControl_.highWaterMark != 0) {
+      conn->setHighWaterMarkCallback(
+          std::bind(&BaseServer::onHighWaterMark, this, _1, _2),
+          flowControl_.highWaterMark);
+    }
   } else {
     INFO("connection {} fail", conn->peer().toIpPort());
+    auto& ctx = getConnectionContext(conn);
+    if (ctx.pauseReasons != 0) {
+      ctx.pauseReasons = 0;
+      endPause(ctx);
+    }
   }
 }
 
+// 共享内存连接以控制连接作为上层的连接, 数据通道记录在连接上下文中
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::onShmConnection(const TcpConnectionPtr& conn,
+                                                 const ShmChannelPtr& channel) {
+  onConnection(conn);
+  if (conn->connected()) getConnectionContext(conn).shm = channel;
+}
+
+#ifdef GOA_RPC_IO_URING
+// 与共享内存相同, 数据通道记录在连接上下文中
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::onUringConnection(
+    const TcpConnectionPtr& conn, const std::shared_ptr<UringConnection>& uring) {
+  onConnection(conn);
+  if (conn->connected()) getConnectionContext(conn).uring = uring;
+}
+#endif
+
 template <typename ProtocolServer>
 void BaseServer<ProtocolServer>::onMessage(const TcpConnectionPtr& conn,
                                            Buffer& buf) {
@@ -58,8 +219,22 @@ void BaseServer<ProtocolServer>::onMessage(const TcpConnectionPtr& conn,
   // 失败则返回错误信息 以json发送给客户端
   catch (RequestException& e) {
     json::Value response = wrapException(e);
-    sendResponse(conn, response);
-    conn->shutdown();
+    auto& ctx = getConnectionContext(conn);
+    if (ctx.framing() == FramingMode::HTTP) {
+      // 格式错误之后无法确定下一个request的边界, 排在已收到的request之后回复400并关闭连接
+      uint64_t seq = ctx.httpNextSeq++;
+      ctx.httpClosing = true;
+      {
+        std::lock_guard lock(ctx.outputMutex);
+        ctx.httpCloseSeq = seq;
+      }
+      RpcResponse body(response);
+      sendHttpResponse(conn, seq, HttpStatus::BAD_REQUEST, &body, false);
+    } else {
+      sendResponse(conn, response);
+      flushResponses(conn);  // shutdown之后无法再发送, 先把合并中的response发出去
+      ctx.shutdown(conn);
+    }
 
     WARN("BaseServer::onMessage() {} request error: {}",
          conn->peer().toIpPort(), e.what());
@@ -71,83 +246,180 @@ void BaseServer<ProtocolServer>::onHighWaterMark(const TcpConnectionPtr& conn,
                                                  size_t mark) {
   /*
    *如果没有发生write错误，并且还有数据没有写完，说明sockfd_的内核缓冲区已满，只写了一部分进去，
-   *此刻将会触发高水位回调，并且注册sockfd_(channel_) 的EPOLLOUT事件，
-   *当channel_中有数据出去后，内核缓冲区将有空余空间，
-   *此时将之前没写完，暂存在outputBuffer_中的数据继续向sockfd_的内核缓冲区写入
-   * 高水位回调, fd会stopRea, 当完成一次write之后再重新startRead
+   *暂存在outputBuffer_中的数据超过高水位时触发此回调, 说明对端读response的速度跟不上,
+   *暂停读该连接, 等outputBuffer_全部写出之后再恢复
+   *这只是兜底, 正常情况下由request额度控制, 见FlowControl
    */
 
-  DEBUG("connection {} high watermark {},stop read", conn->peer().toIpPort(),
-        mark);
-  conn->stopRead();
+  DEBUG("connection {} high watermark {}", conn->peer().toIpPort(), mark);
+  pauseRead(conn, ConnectionContext::PAUSE_OUTPUT);
 }
 
 template <typename ProtocolServer>
 void BaseServer<ProtocolServer>::onWriteComplete(const TcpConnectionPtr& conn) {
-  DEBUG("connection {} write complete", conn->peer().toIpPort());
-  conn->startRead();
+  resumeRead(conn, ConnectionContext::PAUSE_OUTPUT);
 }
 
-/* message有header和body两部分组成
-header: body的长度
-body: response + crlf分隔符
+// 一个request占用的流量控制额度, 所有副本都析构时归还
+// notify和分发时出错的request不会调用done, 因此不能只在done中归还
+template <typename ProtocolServer>
+class BaseServer<ProtocolServer>::RequestCredit : noncopyable {
+ public:
+  RequestCredit(BaseServer* server, const TcpConnectionPtr& conn, size_t bytes)
+      : server_(server), conn_(conn), bytes_(bytes) {
+    auto& ctx = getConnectionContext(conn_);
+    ctx.inflightRequests.fetch_add(1);
+    ctx.inflightBytes.fetch_add(bytes_);
+  }
+  ~RequestCredit() { server_->releaseCredit(conn_, bytes_); }
+
+  const TcpConnectionPtr& conn() const { return conn_; }
 
-内存分布：header + "\r\n" + body + "\r\n"
-服务端和客户端都按这个格式收发信息
+ private:
+  BaseServer* server_;
+  TcpConnectionPtr conn_;
+  size_t bytes_;
+};
+
+/* message有header和body两部分组成, 分帧方式见utils/Frame.hpp
+TEXT:   header + "\r\n" + body + "\r\n", header为十进制的body长度
+BINARY: 8字节定长header + body
+服务端和客户端都按这个格式收发信息, 服务端根据连接的第一帧确定该连接的分帧方式
 */
-// 从buf中获取消息string
+// 从buf中拆出消息, 不完整的帧留在buf中, 由连接上的decoder记住解析进度
+// input为连接的输入buffer, 或者为排队的ctx.queuedInput
 template <typename ProtocolServer>
 void BaseServer<ProtocolServer>::handleMessage(const TcpConnectionPtr& conn,
-                                               Buffer& buf) {
-  // 消息体格式为header+body 都以\r\n结尾  具体参考sendRequest()函数
+                                               Buffer& input) {
+  auto& ctx = getConnectionContext(conn);
+  auto& decoder = ctx.decoder;
+  // 已有排队的帧时, 新到达的数据追加在其后
+  bool queued = &input == &ctx.queuedInput;
+  // 本次读到数据的时间, 在其中结束的帧都以它作为收到的时间
+  Deadline::TimePoint received;
+  if (!queued) received = Deadline::Clock::now();
+  if (!queued && ctx.queuedInput.readableBytes() > 0) {
+    ctx.queuedInput.append(input.peek(), input.readableBytes());
+    ctx.recordArrival(input.readableBytes(), received, false);
+    input.retrieveAll();
+    queued = true;
+  }
+  Buffer& buf = queued ? ctx.queuedInput : input;
+  ctx.inputQueued = false;
+
   while (true) {
-    const char* crlf = buf.findCRLF();
-    if (crlf == nullptr) break;
-    if (crlf == buf.peek()) {  //空消息
-      buf.retrieve(2);
+    // 即将关闭的HTTP连接不再处理之后的request
+    if (ctx.httpClosing) {
+      buf.retrieveAll();
       break;
     }
 
-    size_t headerLen =
-        static_cast<size_t>(crlf - buf.peek() + 2);  // crlf长度为2
-
-    json::Document header;
-    auto err = header.parse(buf.peek(), headerLen);
+    // 达到并发上限, 之后的帧留在buf中排队, 有request完成时再继续分发
+    if (concurrencyExhausted(flowControl_, ctx.inflightRequests)) {
+      ctx.inputQueued = true;
+      // 置位之前完成的request看不到inputQueued, 复查一次
+      if (concurrencyExhausted(flowControl_, ctx.inflightRequests)) break;
+      ctx.inputQueued = false;
+    }
 
-    if (err != json::ParseError::PARSE_OK || !header.isInt32() ||
-        header.getInt32() <= 32) {
+    auto status = decoder.decode(buf);
+    if (status == FrameDecoder::Status::INCOMPLETE) break;
+    if (status == FrameDecoder::Status::ERROR) {
       throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                             "invalid message header");
+                             decoder.error());
     }
 
-    auto jsonLen = static_cast<uint32_t>(header.getInt32());
-    if (jsonLen > kMaxMessageLen) {
-      throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                             "meaasge is too long");
+    // 排队的帧可能在之前的某次读中就已完整, 以那次读到的时间为准
+    auto arrival =
+        queued ? ctx.queuedArrival(decoder.frameBytes()) : received;
+
+    if (decoder.mode() == FramingMode::HTTP) {
+      handleHttpRequest(conn, buf, arrival);
+      continue;
     }
 
-    if (buf.readableBytes() < headerLen + jsonLen) {
-      throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                             "message is incomplete");
+    // body直接在buf中原地解析, 不拷贝到string, 分发完成后再从buf中取走
+    // handleRequest抛出异常时也要取走, 保证decoder与buf一致
+    try {
+      // done持有额度, 同步完成的request在handleRequest返回时就已归还
+      auto credit =
+          makePooled<RequestCredit>(this, conn, decoder.body(buf).size());
+      // 调用子类类型对象中的handleRequest
+      convert().handleRequest(
+          decoder.body(buf), decoder.codec(), arrival,
+          [credit, this](const RpcResponse& response) {
+            if (!response.isNull()) {
+              sendResponse(credit->conn(), response);
+              TRACE("BaseServer::handleMessage() {} request&&response success",
+                    credit->conn()->peer().toIpPort())
+            } else {
+              TRACE(
+                  "BaseServer::handleMessage() {} notify success",
+                  credit->conn()->peer()
+                      .toIpPort());  // notify是没有response的，按协议无需发送应答给客户端
+            }
+          });
+    } catch (...) {
+      decoder.consume(buf);
+      throw;
     }
+    decoder.consume(buf);
+  }
 
-    buf.retrieve(headerLen);
-    auto json_str = buf.retrieveAsString(jsonLen);
-    // 调用子类类型对象中的handleRequest
-    convert().handleRequest(json_str, [conn,
-                                       this](const json::Value& response) {
-      if (!response.isNull()) {
-        sendResponse(conn, response);
-        TRACE("BaseServer::handleMessage() {} request&&response success",
-              conn->peer().toIpPort())
-      } else {
-        TRACE(
-            "BaseServer::handleMessage() {} notify success",
-            conn->peer()
-                .toIpPort());  // notify是没有response的，按协议无需发送应答给客户端
-      }
-    });
+  if (!queued && ctx.inputQueued) {
+    // 连接的输入buffer之后还会被写入, 排队的帧换到连接上下文中, queuedInput此时为空
+    // 其中完整的帧都在本次读到的数据中结束, 之前的帧早已分发
+    ctx.queuedInput.swap(input);
+    ctx.recordArrival(ctx.queuedInput.readableBytes(), received, true);
+  } else if (queued && &input != &ctx.queuedInput && !ctx.inputQueued) {
+    // 只剩不完整的帧, 换回连接的输入buffer(此时为空), 之后读到的数据不再需要拷贝
+    input.swap(ctx.queuedInput);
+  }
+  // 已读到的request全部分发或排队之后再检查, 因此字节数是软上限, 最多超出一次读到的数据
+  updateCredit(conn);
+}
+
+// body同样在buf中原地解析, response按request的顺序发送, 见ConnectionContext
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::handleHttpRequest(
+    const TcpConnectionPtr& conn, Buffer& buf, Deadline::TimePoint received) {
+  auto& ctx = getConnectionContext(conn);
+  auto& decoder = ctx.decoder;
+  uint64_t seq = ctx.httpNextSeq++;
+  bool keepAlive = decoder.keepAlive();
+  if (!keepAlive) {
+    ctx.httpClosing = true;
+    std::lock_guard lock(ctx.outputMutex);
+    ctx.httpCloseSeq = seq;
+  }
+
+  auto exchange = makePooled<HttpExchange>(
+      [conn, seq, keepAlive, this](const RpcResponse* response) {
+        // notify以及全部由notify组成的batch没有response
+        bool empty = response == nullptr ||
+                     (response->hasValue() &&
+                      response->value().getType() ==
+                          json::ValueType::TYPE_ARRAY &&
+                      response->value().getSize() == 0);
+        sendHttpResponse(conn, seq,
+                         empty ? HttpStatus::NO_CONTENT : HttpStatus::OK,
+                         empty ? nullptr : response, keepAlive);
+      });
+
+  auto credit = makePooled<RequestCredit>(this, conn, decoder.body(buf).size());
+  try {
+    convert().handleRequest(decoder.body(buf), CodecId::JSON, received,
+                            [exchange, credit](const RpcResponse& response) {
+                              exchange->reply(response);
+                            });
+  } catch (RequestException& e) {
+    // 分帧正确, 只是request本身非法, 以json-rpc error回复, 连接保持
+    exchange->reply(wrapException(e));
+  } catch (...) {
+    decoder.consume(buf);
+    throw;
   }
+  decoder.consume(buf);
 }
 
 /*
@@ -177,18 +449,194 @@ json::Value BaseServer<ProtocolServer>::wrapException(RequestException& e) {
 
 template <typename ProtocolServer>
 void BaseServer<ProtocolServer>::sendResponse(const TcpConnectionPtr& conn,
-                                              const json::Value& response) {
-  json::StringWriteStream os;
-  json::Writer writer(os);
-
-  response.writeTo(writer);  // writer实现了递归解析和处理
-                             // message即回复消息, 格式为header+body
-  // header为消息长度, body为json格式的回复内容, header和body以\r\n结尾
-  auto message = std::to_string(os.getStringView().length() + 2)
-                     .append("\r\n")
-                     .append(os.getStringView())
-                     .append("\r\n");
-  conn->send(message);
+                                              const RpcResponse& response) {
+  // message即回复消息, 格式为header+body, 与该连接收到的request使用相同的分帧方式和编码方式
+  auto& ctx = getConnectionContext(conn);
+  auto framing = ctx.framing();
+  if (framing == FramingMode::UNKNOWN) framing = FramingMode::TEXT;
+  auto codec = ctx.codec();
+
+  if (flushPolicy_ == FlushPolicy::IMMEDIATE) {
+    // response直接序列化进本线程的buffer, header回填, 然后整体交给连接发送
+    // 在IO线程中调用时TcpConnection直接从该buffer写socket或拷入outputBuffer
+    thread_local Buffer buf;
+    appendFrame(buf, framing, codec, response);  // writer实现了递归解析和处理
+    ctx.send(conn, buf);
+    buf.retrieveAll();  // 连接已断开时send不会取走数据
+    return;
+  }
+
+  // 合并模式: 追加到连接的待发送buffer, 只有第一个response负责安排flush
+  bool schedule;
+  {
+    std::lock_guard lock(ctx.outputMutex);
+    appendFrame(ctx.pendingOutput, framing, codec, response);
+    schedule = !ctx.flushScheduled;
+    ctx.flushScheduled = true;
+  }
+  if (schedule) scheduleFlush(conn);
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::sendHttpResponse(const TcpConnectionPtr& conn,
+                                                  uint64_t seq,
+                                                  HttpStatus status,
+                                                  const RpcResponse* response,
+                                                  bool keepAlive) {
+  auto& ctx = getConnectionContext(conn);
+  bool schedule = false;
+  bool close;
+  {
+    std::lock_guard lock(ctx.outputMutex);
+    if (seq != ctx.httpSendSeq) {
+      // 前面还有未完成的request, 先暂存
+      appendHttpResponse(ctx.httpReorder[seq], status, response, keepAlive);
+      return;
+    }
+
+    appendHttpResponse(ctx.pendingOutput, status, response, keepAlive);
+    ++ctx.httpSendSeq;
+    // 紧随其后且已完成的response按序追加
+    auto it = ctx.httpReorder.begin();
+    while (it != ctx.httpReorder.end() && it->first == ctx.httpSendSeq) {
+      ctx.pendingOutput.append(it->second.peek(), it->second.readableBytes());
+      ++ctx.httpSendSeq;
+      it = ctx.httpReorder.erase(it);
+    }
+
+    close = ctx.httpSendSeq > ctx.httpCloseSeq;
+    if (flushPolicy_ == FlushPolicy::IMMEDIATE || close) {
+      ctx.send(conn, ctx.pendingOutput);
+      ctx.pendingOutput.retrieveAll();  // 连接已断开时send不会取走数据
+    } else {
+      schedule = !ctx.flushScheduled;
+      ctx.flushScheduled = true;
+    }
+  }
+
+  if (close) {
+    ctx.shutdown(conn);
+  } else if (schedule) {
+    scheduleFlush(conn);
+  }
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::scheduleFlush(const TcpConnectionPtr& conn) {
+  // queueInLoop的任务在本轮事件处理完之后执行, 此前产生的response都会被合并
+  auto loop = conn->getLoop();
+  if (flushPolicy_ == FlushPolicy::LOOP_ITERATION || flushDelay_ == 0us) {
+    loop->queueInLoop([conn, this]() { flushResponses(conn); });
+  } else {
+    loop->runInLoop([conn, loop, this]() {
+      loop->runAfter(flushDelay_, [conn, this]() { flushResponses(conn); });
+    });
+  }
+}
+
+// 将合并中的response一次性交给连接, 只在IO线程中调用
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::flushResponses(const TcpConnectionPtr& conn) {
+  auto& ctx = getConnectionContext(conn);
+  std::lock_guard lock(ctx.outputMutex);
+  ctx.flushScheduled = false;
+  if (ctx.pendingOutput.readableBytes() == 0) return;
+  ctx.send(conn, ctx.pendingOutput);
+  ctx.pendingOutput.retrieveAll();  // 连接已断开时send不会取走数据
+}
+
+// 以下只在IO线程中调用, releaseCredit除外
+// 字节数按执行中和排队中的request一起计算
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::updateCredit(const TcpConnectionPtr& conn) {
+  auto& ctx = getConnectionContext(conn);
+  if (!(ctx.pauseReasons & ConnectionContext::PAUSE_CREDIT)) {
+    if (!creditExhausted(flowControl_,
+                         ctx.inflightBytes + ctx.queuedInput.readableBytes())) {
+      return;
+    }
+    pauseRead(conn, ConnectionContext::PAUSE_CREDIT);
+    ctx.creditPaused = true;
+    // 置位之前归还额度的线程看不到creditPaused, 由下面补上检查
+  }
+  if (creditRecovered(flowControl_,
+                      ctx.inflightBytes + ctx.queuedInput.readableBytes())) {
+    ctx.creditPaused = false;
+    resumeRead(conn, ConnectionContext::PAUSE_CREDIT);
+  }
+}
+
+// 可以在任意线程中调用, request完成时由RequestCredit调用
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::releaseCredit(const TcpConnectionPtr& conn,
+                                               size_t bytes) {
+  auto& ctx = getConnectionContext(conn);
+  size_t requests = ctx.inflightRequests.fetch_sub(1) - 1;
+  size_t inflightBytes = ctx.inflightBytes.fetch_sub(bytes) - bytes;
+  // 排队的字节数只能在IO线程中读取, 这里先按执行中的字节数判断, IO线程中再复查
+  bool wakeup = (ctx.inputQueued &&
+                 !concurrencyExhausted(flowControl_, requests)) ||
+                (ctx.creditPaused && creditRecovered(flowControl_, inflightBytes));
+  // 多个request同时完成时只安排一次
+  if (wakeup && !ctx.wakeupScheduled.exchange(true)) {
+    conn->getLoop()->queueInLoop([conn, this]() { onCreditReleased(conn); });
+  }
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::onCreditReleased(const TcpConnectionPtr& conn) {
+  auto& ctx = getConnectionContext(conn);
+  ctx.wakeupScheduled = false;
+  if (ctx.inputQueued && conn->connected()) {
+    onMessage(conn, ctx.queuedInput);  // 其中会调用updateCredit
+  } else {
+    updateCredit(conn);
+  }
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::pauseRead(const TcpConnectionPtr& conn,
+                                           uint8_t reason) {
+  auto& ctx = getConnectionContext(conn);
+  if (ctx.pauseReasons == 0) {
+    DEBUG("connection {} stop read, reason {}", conn->peer().toIpPort(),
+          reason);
+    ctx.stopRead(conn);
+    ctx.pausedSince = std::chrono::steady_clock::now();
+    pauses_++;
+    pausedConnections_++;
+  }
+  ctx.pauseReasons |= reason;
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::resumeRead(const TcpConnectionPtr& conn,
+                                            uint8_t reason) {
+  auto& ctx = getConnectionContext(conn);
+  if (!(ctx.pauseReasons & reason)) return;
+  ctx.pauseReasons &= static_cast<uint8_t>(~reason);
+  if (ctx.pauseReasons != 0) return;
+
+  DEBUG("connection {} start read", conn->peer().toIpPort());
+  endPause(ctx);
+  if (conn->connected()) ctx.startRead(conn);
+}
+
+template <typename ProtocolServer>
+void BaseServer<ProtocolServer>::endPause(ConnectionContext& ctx) {
+  auto paused = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - ctx.pausedSince);
+  pausedMicros_ += static_cast<uint64_t>(paused.count());
+  pausedConnections_--;
+}
+
+template <typename ProtocolServer>
+FlowControlStats BaseServer<ProtocolServer>::flowControlStats() const {
+  FlowControlStats stats;
+  stats.pauses = pauses_;
+  stats.pausedMicros = pausedMicros_;
+  stats.pausedConnections = pausedConnections_;
+  return stats;
 }
 
 template <typename ProtocolServer>
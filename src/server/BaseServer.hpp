@@ -1,38 +1,146 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 
 #include "goa-json/include/Value.hpp"
+#include "transport/ShmAddress.hpp"
+#include "transport/ShmChannel.hpp"
+#include "transport/UnixAddress.hpp"
+#include "utils/Deadline.hpp"
 #include "utils/Exception.hpp"
+#include "utils/Frame.hpp"
 #include "utils/utils.hpp"
 namespace goa {
 namespace rpc {
 
+class UnixServer;
+class ShmServer;
+class ReusePortServer;
+class UringServer;
+class UringConnection;
+struct ConnectionContext;
+
+// response的发送策略
+enum class FlushPolicy {
+  IMMEDIATE,       // 每个response单独send, 默认
+  LOOP_ITERATION,  // 同一连接在一轮事件循环内产生的response合并为一次write
+  DELAY,           // 同一连接在flushDelay时间窗口内产生的response合并为一次write
+};
+
+// TCP连接的IO方式
+enum class IoBackend {
+  EPOLL,     // 默认, 由goa-ev的EventLoop读写
+  IO_URING,  // multishot recv + provided buffer ring, send批量提交, 需要以GOA_RPC_WITH_IO_URING编译
+};
+
+/* 每个连接的流量控制, 代替固定64KB高水位的停读/恢复, 上限为0表示不限制该项
+额度按未完成的工作计算, request已分发但尚未完成(response已交给连接, 或notify已执行完)时占用额度
+*/
+struct FlowControl {
+  // 同时执行的request数量上限, 达到后新的帧留在decoder中排队, 有request完成时再分发,
+  // 因此一个连接最多占用线程池中这么多个任务, response仍按完成的顺序发送(HTTP除外)
+  size_t maxInflightRequests = 128;
+  // 执行中和排队中的request字节数上限, 超过时暂停读该连接, 降到一半以下时恢复,
+  // 避免在阈值附近频繁切换
+  size_t maxInflightBytes = 64 * 1024 * 1024;
+  // 连接输出缓冲区的上限, 用于对端不读response的情况, 超过时暂停读, 全部写出后恢复
+  // 只对epoll方式的TCP和Unix domain socket连接有效
+  size_t highWaterMark = 4 * 1024 * 1024;
+};
+
+// 流量控制的统计, 可以在任意线程中读取
+struct FlowControlStats {
+  uint64_t pauses = 0;             // 暂停读的次数
+  uint64_t pausedMicros = 0;       // 已结束的暂停的总时长
+  uint64_t pausedConnections = 0;  // 当前处于暂停中的连接数
+};
+
 // CRTP设计模式 此为基类  派生类声明为基类的模板参数 实现静态多态
 template <typename ProtocolServer>
 class BaseServer {
  public:
-  void setNumThreads(int numThreads) { server_.setNumThread(numThreads); }
-  void start() { server_.start(); }
+  // 只对TcpServer有效, 其余方式的连接都在构造时传入的loop中处理
+  void setNumThreads(int numThreads);
+  void start();
+
+  // 类似Nagle算法, 在start()之前设置. 流水线请求较多时可以减少write系统调用
+  void setFlushPolicy(FlushPolicy policy,
+                      std::chrono::microseconds delay = 0us) {
+    flushPolicy_ = policy;
+    flushDelay_ = delay;
+  }
+
+  // 在start()之前设置
+  void setFlowControl(const FlowControl& flowControl) {
+    flowControl_ = flowControl;
+  }
+  FlowControlStats flowControlStats() const;
 
  protected:
   // CRTP常用权限控制  基类不能实例化 因为其依赖于派生类来实现
   BaseServer(EventLoop* loop, const InetAddress& local);
-  ~BaseServer() = default;
+  // reusePort为true时监听socket设置SO_REUSEPORT, 只使用loop一个线程,
+  // 多个server可以绑定同一地址, 见ShardedRpcServer
+  // backend为IO_URING时同样只使用loop一个线程, 编译时未启用或内核不支持时退回EPOLL
+  BaseServer(EventLoop* loop, const InetAddress& local, bool reusePort,
+             IoBackend backend = IoBackend::EPOLL);
+  BaseServer(EventLoop* loop, const UnixAddress& local);
+  BaseServer(EventLoop* loop, const ShmAddress& local);
+  ~BaseServer();
   json::Value wrapException(RequestException& e);
 
  private:
+  class RequestCredit;
+  using RequestCreditPtr = std::shared_ptr<RequestCredit>;
+
+  template <typename Server>
+  void bindCallbacks(Server& server);
+
   void onConnection(const TcpConnectionPtr& conn);
+  void onShmConnection(const TcpConnectionPtr& conn,
+                       const ShmChannelPtr& channel);
+  void onUringConnection(const TcpConnectionPtr& conn,
+                         const std::shared_ptr<UringConnection>& uring);
   void onMessage(const TcpConnectionPtr& conn, Buffer& buf);
   void onWriteComplete(const TcpConnectionPtr& conn);
   void onHighWaterMark(const TcpConnectionPtr& conn, size_t mark);
 
   void handleMessage(const TcpConnectionPtr& conn, Buffer& buf);
-  void sendResponse(const TcpConnectionPtr& conn, const json::Value& response);
+  // received为该帧读到的时间
+  void handleHttpRequest(const TcpConnectionPtr& conn, Buffer& buf,
+                         Deadline::TimePoint received);
+  void sendResponse(const TcpConnectionPtr& conn, const RpcResponse& response);
+  void sendHttpResponse(const TcpConnectionPtr& conn, uint64_t seq,
+                        HttpStatus status, const RpcResponse* response,
+                        bool keepAlive);
+  void scheduleFlush(const TcpConnectionPtr& conn);
+  void flushResponses(const TcpConnectionPtr& conn);
+
+  void updateCredit(const TcpConnectionPtr& conn);
+  void releaseCredit(const TcpConnectionPtr& conn, size_t bytes);
+  void onCreditReleased(const TcpConnectionPtr& conn);
+  void pauseRead(const TcpConnectionPtr& conn, uint8_t reason);
+  void resumeRead(const TcpConnectionPtr& conn, uint8_t reason);
+  void endPause(ConnectionContext& ctx);
 
   ProtocolServer& convert();  // 基类转换为子类
   const ProtocolServer& convert() const;
 
-  TcpServer server_;
+  // 只有一个非空, 取决于监听的地址类型
+  std::unique_ptr<TcpServer> tcpServer_;
+  std::unique_ptr<ReusePortServer> reusePortServer_;
+  std::unique_ptr<UringServer> uringServer_;  // 未启用io_uring时始终为空
+  std::unique_ptr<UnixServer> unixServer_;
+  std::unique_ptr<ShmServer> shmServer_;
+  FlushPolicy flushPolicy_ = FlushPolicy::IMMEDIATE;
+  std::chrono::microseconds flushDelay_ = 0us;
+  FlowControl flowControl_;
+  std::atomic<uint64_t> pauses_ = 0;
+  std::atomic<uint64_t> pausedMicros_ = 0;
+  std::atomic<uint64_t> pausedConnections_ = 0;
 };
 }  // namespace rpc
 }  // namespace goa
\ No newline at end of file
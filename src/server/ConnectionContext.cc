@@ -0,0 +1,86 @@
+#include "server/ConnectionContext.hpp"
+
+#include <cassert>
+
+#ifdef GOA_RPC_IO_URING
+#include "transport/UringServer.hpp"
+#endif
+
+namespace goa {
+namespace rpc {
+
+void ConnectionContext::recordArrival(size_t bytes,
+                                      Deadline::TimePoint received,
+                                      bool reset) {
+  if (reset) {
+    queuedArrivals.clear();
+    queuedAppended = 0;
+  }
+  queuedAppended += bytes;
+  queuedArrivals.emplace_back(queuedAppended, received);
+}
+
+Deadline::TimePoint ConnectionContext::queuedArrival(size_t frameBytes) {
+  assert(!queuedArrivals.empty());
+  uint64_t end = queuedAppended - queuedInput.readableBytes() + frameBytes;
+  // 帧按顺序分发, 结束位置在此之前的记录之后不再需要
+  while (queuedArrivals.size() > 1 && queuedArrivals.front().first < end) {
+    queuedArrivals.pop_front();
+  }
+  return queuedArrivals.front().second;
+}
+
+void ConnectionContext::send(const TcpConnectionPtr& conn, Buffer& buf) {
+#ifdef GOA_RPC_IO_URING
+  if (uring) {
+    uring->send(buf);
+    return;
+  }
+#endif
+  if (shm) {
+    shm->send(buf);
+  } else {
+    conn->send(buf);
+  }
+}
+
+void ConnectionContext::shutdown(const TcpConnectionPtr& conn) {
+#ifdef GOA_RPC_IO_URING
+  if (uring) {
+    uring->shutdown();
+    return;
+  }
+#endif
+  conn->shutdown();
+}
+
+void ConnectionContext::stopRead(const TcpConnectionPtr& conn) {
+#ifdef GOA_RPC_IO_URING
+  if (uring) {
+    uring->stopRead();
+    return;
+  }
+#endif
+  if (shm) {
+    shm->stopRead();
+  } else {
+    conn->stopRead();
+  }
+}
+
+void ConnectionContext::startRead(const TcpConnectionPtr& conn) {
+#ifdef GOA_RPC_IO_URING
+  if (uring) {
+    uring->startRead();
+    return;
+  }
+#endif
+  if (shm) {
+    shm->startRead();
+  } else {
+    conn->startRead();
+  }
+}
+
+}  // namespace rpc
+}  // namespace goa
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "transport/ShmChannel.hpp"
+#include "utils/Deadline.hpp"
+#include "utils/Frame.hpp"
+#include "utils/FrameDecoder.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+namespace rpc {
+
+class UringConnection;
+
+// 每个连接的状态, 在onConnection时通过TcpConnection::setContext挂到连接上
+struct ConnectionContext : noncopyable {
+  explicit ConnectionContext(size_t maxMessageLen) : decoder(maxMessageLen) {}
+
+  // 分帧方式由连接的第一帧决定, 之后该连接的request和response都使用这种分帧方式
+  FramingMode framing() const { return decoder.mode(); }
+  // 编码方式同样由第一帧决定, 见utils/Frame.hpp
+  CodecId codec() const { return decoder.codec(); }
+
+  FrameDecoder decoder;  // 只在IO线程中使用
+
+  // 等待合并发送的response, 见FlushPolicy. response可能在线程池中产生, 需加锁
+  std::mutex outputMutex;
+  Buffer pendingOutput;
+  bool flushScheduled = false;
+
+  /* HTTP pipelining: response必须按request的顺序发送, 而request可能在线程池中乱序完成
+  每个request按到达顺序编号, 编号为httpSendSeq的response直接进入pendingOutput,
+  提前完成的暂存在httpReorder中, 等前面的response都发出后再按序追加
+  */
+  uint64_t httpNextSeq = 0;  // 只在IO线程中使用
+  bool httpClosing = false;  // 只在IO线程中使用, 已收到Connection: close或格式错误的request
+  // 以下由outputMutex保护
+  uint64_t httpSendSeq = 0;
+  uint64_t httpCloseSeq = std::numeric_limits<uint64_t>::max();  // 该response发出后关闭连接
+  std::map<uint64_t, Buffer> httpReorder;
+
+  /* 流量控制, 见FlowControl
+  额度在IO线程中分发request时占用, 在request完成时归还, 可能在线程池中
+  inputQueued、creditPaused与额度计数都用seq_cst: IO线程先置位再复查额度,
+  归还时先减计数再检查标志, 保证在置位前后归还的额度至少有一方能看到, 连接不会一直停住
+  */
+  std::atomic<size_t> inflightRequests = 0;
+  std::atomic<size_t> inflightBytes = 0;
+  std::atomic<bool> inputQueued = false;  // 达到并发上限, 有帧在queuedInput中排队
+  std::atomic<bool> creditPaused = false;
+  std::atomic<bool> wakeupScheduled = false;
+  Buffer queuedInput;  // 只在IO线程中使用, 排队的帧和之后到达的数据
+  /* 排队的数据到达的时间, 只在IO线程中使用. request的timeout从帧的最后一个字节读到时开始计算,
+  在queuedInput中排队的时间也计算在内. 每项为一次读到的数据在queuedInput中的结束位置和读到的时间,
+  位置从开始排队时累计
+  */
+  std::deque<std::pair<uint64_t, Deadline::TimePoint>> queuedArrivals;
+  uint64_t queuedAppended = 0;  // 开始排队以来追加到queuedInput的字节数
+
+  // 追加到queuedInput的bytes字节在received时读到, 开始排队时reset为true
+  void recordArrival(size_t bytes, Deadline::TimePoint received, bool reset);
+  // queuedInput中的下一帧共frameBytes字节时, 它的最后一个字节读到的时间
+  Deadline::TimePoint queuedArrival(size_t frameBytes);
+  // 暂停读的原因, 只在IO线程中使用, 全部解除后才恢复读
+  enum PauseReason : uint8_t {
+    PAUSE_CREDIT = 1,
+    PAUSE_OUTPUT = 2,
+  };
+  uint8_t pauseReasons = 0;
+  std::chrono::steady_clock::time_point pausedSince;
+
+  // 共享内存连接的数据通道, 非空时request和response都经过它, 而不是TcpConnection
+  ShmChannelPtr shm;
+  // io_uring连接, 非空时数据经过UringServer的io_uring收发
+  // 未启用io_uring时始终为空, 成员仍然保留, 类的布局与编译选项无关
+  std::shared_ptr<UringConnection> uring;
+
+  void send(const TcpConnectionPtr& conn, Buffer& buf);
+  // 已交给send()的数据发出后关闭写端
+  void shutdown(const TcpConnectionPtr& conn);
+  // 暂停/恢复接收request, 暂停期间已到达的数据在恢复后处理
+  void stopRead(const TcpConnectionPtr& conn);
+  void startRead(const TcpConnectionPtr& conn);
+};
+
+using ConnectionContextPtr = std::shared_ptr<ConnectionContext>;
+
+inline ConnectionContext& getConnectionContext(const TcpConnectionPtr& conn) {
+  return *std::any_cast<const ConnectionContextPtr&>(conn->getContext());
+}
+
+}  // namespace rpc
+}  // namespace goa
@@ -0,0 +1,127 @@
+#include "server/MethodTable.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 每个桶平均的key数量, 越大桶越少(位移数组越小), 构建时越难找到位移
+constexpr size_t kKeysPerBucket = 4;
+constexpr uint32_t kMaxDisplacement = 1u << 16;
+constexpr int kMaxSeeds = 64;
+
+size_t roundUpPowerOf2(size_t n) {
+  size_t size = 1;
+  while (size < n) size <<= 1;
+  return size;
+}
+
+// splitmix64的finalizer
+uint64_t mix(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return h;
+}
+
+}  // anonymous namespace
+
+// FNV-1a, method名都很短
+uint64_t MethodTable::hash(std::string_view key, uint64_t seed) {
+  uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+  for (char c : key) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 0x100000001b3ULL;
+  }
+  return mix(h);
+}
+
+size_t MethodTable::slotIndex(uint64_t h, uint32_t displacement) const {
+  return static_cast<size_t>(mix(h + displacement * 0x9e3779b97f4a7c15ULL)) &
+         slotMask_;
+}
+
+void MethodTable::build(std::vector<Entry> entries) {
+  entries_ = std::move(entries);
+  displacements_.clear();
+  slots_.clear();
+  if (entries_.empty()) return;
+
+  // 槽的数量留出20%的空闲, 构建更快
+  slotMask_ = roundUpPowerOf2(entries_.size() + entries_.size() / 4) - 1;
+  bucketMask_ =
+      roundUpPowerOf2((entries_.size() + kKeysPerBucket - 1) / kKeysPerBucket) -
+      1;
+
+  // 两个key的64位哈希值相同时任何位移都无法分开, 换一个seed重新构建
+  for (uint64_t seed = 0; seed < kMaxSeeds; seed++) {
+    if (tryBuild(seed)) {
+      seed_ = seed;
+      return;
+    }
+  }
+  // 实际上不会发生, 此时entries中有重复的name
+  FATAL("MethodTable::build() failed, {} methods", entries_.size());
+}
+
+bool MethodTable::tryBuild(uint64_t seed) {
+  size_t numBuckets = bucketMask_ + 1;
+  std::vector<uint64_t> hashes(entries_.size());
+  std::vector<std::vector<size_t>> buckets(numBuckets);
+  for (size_t i = 0; i < entries_.size(); i++) {
+    hashes[i] = hash(entries_[i].name, seed);
+    buckets[bucketIndex(hashes[i])].push_back(i);
+  }
+
+  // 先放key多的桶, 此时空槽最多
+  std::vector<size_t> order(numBuckets);
+  for (size_t i = 0; i < numBuckets; i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return buckets[lhs].size() > buckets[rhs].size();
+  });
+
+  displacements_.assign(numBuckets, 0);
+  slots_.assign(slotMask_ + 1, Slot());
+  std::vector<size_t> candidate;
+  for (size_t b : order) {
+    auto& bucket = buckets[b];
+    if (bucket.empty()) break;
+
+    bool placed = false;
+    for (uint32_t d = 0; d < kMaxDisplacement && !placed; d++) {
+      candidate.clear();
+      placed = true;
+      for (size_t i : bucket) {
+        size_t slot = slotIndex(hashes[i], d);
+        // 同一个桶中的key也不能落在同一个槽
+        if (slots_[slot].entry != nullptr ||
+            std::find(candidate.begin(), candidate.end(), slot) !=
+                candidate.end()) {
+          placed = false;
+          break;
+        }
+        candidate.push_back(slot);
+      }
+      if (placed) {
+        displacements_[b] = d;
+        for (size_t k = 0; k < bucket.size(); k++) {
+          slots_[candidate[k]].hash = hashes[bucket[k]];
+          slots_[candidate[k]].entry = &entries_[bucket[k]];
+        }
+      }
+    }
+    if (!placed) return false;
+  }
+  return true;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
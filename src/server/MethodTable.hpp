@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "server/Procedure.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 以"serviceName.methodName"全名为key的分发表, 在RpcServer::start()时由所有service构建, 之后只读
+使用hash and displace(CHD)构建最小完美哈希: 先按哈希值把key分到若干个桶, 从大桶开始为每个桶
+寻找一个位移, 使桶中所有key都落在空槽上. 查找时只计算一次哈希, 读一次位移和一个槽, 再比较一次key,
+槽中保存完整的哈希值, 不存在的method一般在比较哈希值时就被排除
+*/
+class MethodTable : noncopyable {
+ public:
+  // 同名的request和notify可以共存
+  struct Entry {
+    std::string name;
+    ProcedureReturn* procedureReturn = nullptr;
+    ProcedureNotify* procedureNotify = nullptr;
+  };
+
+  // entries的name不能重复
+  void build(std::vector<Entry> entries);
+
+  // 找不到时返回nullptr
+  const Entry* find(std::string_view name) const {
+    if (slots_.empty()) return nullptr;
+    uint64_t h = hash(name, seed_);
+    const Slot& slot = slots_[slotIndex(h, displacements_[bucketIndex(h)])];
+    if (slot.hash != h || slot.entry == nullptr || slot.entry->name != name) {
+      return nullptr;
+    }
+    return slot.entry;
+  }
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Slot {
+    uint64_t hash = 0;
+    const Entry* entry = nullptr;
+  };
+
+  static uint64_t hash(std::string_view key, uint64_t seed);
+
+  size_t bucketIndex(uint64_t h) const {
+    return static_cast<size_t>(h >> 32) & bucketMask_;
+  }
+  size_t slotIndex(uint64_t h, uint32_t displacement) const;
+
+  bool tryBuild(uint64_t seed);
+
+  std::vector<Entry> entries_;
+  std::vector<uint32_t> displacements_;  // 每个桶一个
+  std::vector<Slot> slots_;
+  size_t bucketMask_ = 0;
+  size_t slotMask_ = 0;
+  uint64_t seed_ = 0;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -93,5 +93,16 @@ void Procedure<ProcedureNotifyCallback>::invoke(json::Value& request) {
   callback_(request);
 }
 
+template <>
+bool Procedure<ProcedureReturnCallback>::invokeTyped(
+    std::string_view params, std::string_view id, const RpcDoneCallback& done) {
+  return typedCallback_ && typedCallback_(params, id, done);
+}
+
+template <>
+bool Procedure<ProcedureNotifyCallback>::invokeTyped(std::string_view params) {
+  return typedCallback_ && typedCallback_(params);
+}
+
 }  // namespace rpc
 }  // namespace goa
@@ -1,16 +1,35 @@
 #pragma once
 
+#include <cstddef>
 #include <string_view>
+#include <type_traits>
+#include <utility>
 
 #include "goa-json/include/Value.hpp"
 #include "utils/utils.hpp"
 namespace goa {
 namespace rpc {
 
+class WorkStealingExecutor;
+
 using ProcedureReturnCallback =
     std::function<void(goa::json::Value&, const RpcDoneCallback&)>;
 using ProcedureNotifyCallback = std::function<void(goa::json::Value&)>;
 
+// typed codec的stub直接从params的原始JSON文本读出参数, 不构造json::Value
+// 参数不符时返回false, 由调用者退回json::Value的路径, 因此不能在读完参数之前产生副作用
+// id为request中id的原始JSON文本
+using TypedReturnCallback = std::function<bool(
+    std::string_view params, std::string_view id, const RpcDoneCallback&)>;
+using TypedNotifyCallback = std::function<bool(std::string_view params)>;
+
+// method的执行策略, 由spec.json中的"execution"指定, 见RpcServer::start()
+enum class ExecutionPolicy {
+  INLINE,     // 在IO线程中直接调用, 适合很快就能完成的method
+  SHARED,     // 在RpcServer共享的工作线程池中调用
+  DEDICATED,  // 在该method独占的线程池中调用, 与其他method互不影响
+};
+
 // procedure有两个特化的实现 ProcedureReturn 和 ProcedureNotify
 template <typename Func>
 class Procedure : noncopyable {
@@ -26,11 +45,39 @@ class Procedure : noncopyable {
     }
   }
 
+  using TypedFunc =
+      std::conditional_t<std::is_same_v<Func, ProcedureReturnCallback>,
+                         TypedReturnCallback, TypedNotifyCallback>;
+
+  // 可选, 由stub生成器为参数都是基本类型的method设置
+  void setTypedCallback(TypedFunc callback) {
+    typedCallback_ = std::move(callback);
+  }
+  bool hasTypedCallback() const { return static_cast<bool>(typedCallback_); }
+
+  // 由stub生成器设置, numThreads只用于DEDICATED
+  void setExecution(ExecutionPolicy policy, size_t numThreads = 0) {
+    policy_ = policy;
+    numThreads_ = numThreads;
+  }
+  ExecutionPolicy executionPolicy() const { return policy_; }
+  size_t dedicatedThreads() const { return numThreads_; }
+
+  // 由RpcServer::start()按执行策略设置, nullptr表示在IO线程中调用
+  void setExecutor(WorkStealingExecutor* executor) { executor_ = executor; }
+  WorkStealingExecutor* executor() const { return executor_; }
+
   // 使用时只需要调用invoke  函数内部校验了参数并执行了回调
   void invoke(goa::json::Value& request, const RpcDoneCallback& done);
 
   void invoke(goa::json::Value& request);
 
+  // 没有设置typed callback或者参数不符时返回false
+  bool invokeTyped(std::string_view params, std::string_view id,
+                   const RpcDoneCallback& done);
+
+  bool invokeTyped(std::string_view params);
+
  private:
   template <typename Name, typename... ParamNameAndType>
   void initProcedure(Name paramName, goa::json::ValueType paramType,
@@ -57,7 +104,11 @@ class Procedure : noncopyable {
   };
 
   Func callback_;
+  TypedFunc typedCallback_;
   std::vector<Param> params_;
+  ExecutionPolicy policy_ = ExecutionPolicy::INLINE;
+  size_t numThreads_ = 0;
+  WorkStealingExecutor* executor_ = nullptr;
 };
 
 using ProcedureReturn = Procedure<ProcedureReturnCallback>;
@@ -1,15 +1,28 @@
 #include "server/RpcServer.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <map>
 #include <memory>
-#include <mutex>
+#include <string>
 #include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "goa-json/include/Document.hpp"
 #include "goa-json/include/Exception.hpp"
 #include "goa-json/include/Value.hpp"
+#include "utils/Codec.hpp"
+#include "utils/Deadline.hpp"
 #include "utils/Exception.hpp"
+#include "utils/JsonCursor.hpp"
+#include "utils/ObjectPool.hpp"
 #include "utils/RpcError.hpp"
 #include "utils/utils.hpp"
 
@@ -17,6 +30,67 @@ namespace goa {
 
 namespace rpc {
 
+// request的外层字段, 见scanEnvelope
+struct RequestEnvelope {
+  std::string_view version;
+  std::string_view method;
+  std::string_view id;
+  std::string_view params;
+  json::ValueType idType = json::ValueType::TYPE_NULL;
+  int64_t timeout = 0;  // 毫秒
+  bool hasVersion = false;
+  bool hasMethod = false;
+  bool hasId = false;
+  bool hasParams = false;
+  bool hasTimeout = false;
+};
+
+/* batch的结果集, 每个request在预先分配的slot中有自己的位置, 不同的线程只写各自的slot, 不需要加锁
+每个slot完成(写入response, 或者notify没有response)时倒数一次, 最后一个完成的线程按request的顺序
+把结果集交给done, pending_的acq_rel保证此时所有slot的写入都可见
+用户没有调用某个request的done时, 在最后一个引用析构时交出已有的结果, done只会被调用一次
+*/
+class BatchResponse : noncopyable {
+ public:
+  BatchResponse(size_t n, const RpcDoneCallback& done)
+      : responses_(n), pending_(n), done_(done) {}
+  ~BatchResponse() { complete(); }
+
+  void set(size_t i, json::Value&& response) {
+    responses_[i] = std::move(response);
+    release();
+  }
+  // notify没有response
+  void skip() { release(); }
+
+ private:
+  void release() {
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) complete();
+  }
+
+  void complete() {
+    if (completed_.exchange(true, std::memory_order_acq_rel)) return;
+    bool empty = true;
+    for (auto& response : responses_) {
+      if (!response.isNull()) {
+        empty = false;
+        break;
+      }
+    }
+    if (empty) {
+      // 全部是notify时与原来一样回复空的array
+      done_(json::Value(json::ValueType::TYPE_ARRAY));
+    } else {
+      done_(RpcResponse(responses_.data(), responses_.size()));
+    }
+  }
+
+  std::vector<json::Value> responses_;  // null表示没有response
+  std::atomic<size_t> pending_;
+  std::atomic<bool> completed_{false};
+  RpcDoneCallback done_;
+};
+
 namespace {
 
 // 检测type是否和模板参数之一匹配
@@ -68,84 +142,459 @@ bool hasParams(const json::Value& request) {
   return request.findMember("params") != request.endMember();
 }
 
+/* request中可选的timeout字段: 非负整数, 单位为毫秒, 从server收到request时开始计算
+超过Deadline::kMaxTimeout时视为没有截止时间
+没有timeout时deadline不变, 类型或取值非法时返回false
+*/
+bool findDeadline(const json::Value& request, Deadline::TimePoint received,
+                  Deadline& deadline) {
+  auto it = request.findMember("timeout");
+  if (it == request.endMember()) return true;
+
+  int64_t timeout = 0;
+  switch (it->value.getType()) {
+    case json::ValueType::TYPE_INT32:
+      timeout = it->value.getInt32();
+      break;
+    case json::ValueType::TYPE_INT64:
+      timeout = it->value.getInt64();
+      break;
+    default:
+      return false;
+  }
+  if (timeout < 0) return false;
+  deadline = Deadline(received, std::chrono::milliseconds(timeout));
+  return true;
+}
+
 // 判断是否为一个notify请求，notify没有id，json-rpc 2.0协议
 bool isNotify(const json::Value& request) {
   return request.findMember("id") == request.endMember();
 }
 
-// 用于handleBatchRequest 将response线程安全的放在一起
-class ThreadSafeBatchResponse {
- public:
-  explicit ThreadSafeBatchResponse(const RpcDoneCallback& done)
-      : data_(std::make_shared<ThreadSafeDate>(done)) {}
+// 把envelope中的id转换为json::Value, 类型已由scanEnvelope保证
+json::Value envelopeId(const RequestEnvelope& envelope) {
+  JsonCursor cursor(envelope.id);
+  switch (envelope.idType) {
+    case json::ValueType::TYPE_INT32: {
+      int32_t id = 0;
+      cursor.readInt32(id);
+      return json::Value(id);
+    }
+    case json::ValueType::TYPE_INT64: {
+      int64_t id = 0;
+      cursor.readInt64(id);
+      return json::Value(id);
+    }
+    default: {
+      std::string id;
+      cursor.readString(id);
+      return json::Value(std::string_view(id));
+    }
+  }
+}
+
+// procedure只用到id和params, params在确定可以分发之后才解析
+void addParams(json::Value& request, std::string_view params) {
+  if (params.empty()) return;
+  json::Document document;
+  auto err = document.parse(params.data(), params.size());
+  if (err != json::ParseError::PARSE_OK) {
+    throw RequestException(RpcError(ERROR::RPC_PARSE_ERROR),
+                           json::parseErrorString(err));
+  }
+  request.addMember("params", std::move(document));
+}
 
-  void addResponse(const json::Value& response) {
-    std::lock_guard lock(data_->mutex_);
-    data_->response_.addValue(response);
+// 在IO线程或线程池中排队期间截止时间已过的request不再调用method
+void checkDeadline(const Deadline& deadline, const json::Value& id) {
+  if (deadline.expired()) {
+    throw RequestException(RpcError(ERROR::RPC_DEADLINE_EXCEEDED), id,
+                           "deadline exceeded before method invoked");
   }
+}
 
- private:
-  struct ThreadSafeDate {
-    explicit ThreadSafeDate(const RpcDoneCallback& done)
-        : response_(json::ValueType::TYPE_ARRAY), done_(done) {}
+void checkDeadline(const Deadline& deadline) {
+  if (deadline.expired()) {
+    throw NotifyException(RpcError(ERROR::RPC_DEADLINE_EXCEEDED),
+                          "deadline exceeded before method invoked");
+  }
+}
 
-    ~ThreadSafeDate() { done_(response_); }
+// typed codec直接从params的原始文本读出参数, 参数不符时才为params构造json::Value
+void invokeEnvelope(ProcedureReturn& procedure, std::string_view params,
+                    std::string_view rawId, json::Value id,
+                    const Deadline& deadline, const RpcDoneCallback& done) {
+  checkDeadline(deadline, id);
+  Deadline::Scope scope(deadline);
+  if (procedure.invokeTyped(params, rawId, done)) return;
+
+  json::Value request(json::ValueType::TYPE_OBJECT);
+  request.addMember("id", std::move(id));
+  addParams(request, params);
+  procedure.invoke(request, done);
+}
 
-    std::mutex mutex_;
-    json::Value response_;
-    RpcDoneCallback done_;
-  };
+void invokeEnvelope(ProcedureNotify& procedure, std::string_view params,
+                    const Deadline& deadline) {
+  checkDeadline(deadline);
+  Deadline::Scope scope(deadline);
+  if (procedure.invokeTyped(params)) return;
 
-  using DataPtr = std::shared_ptr<ThreadSafeDate>;
-  DataPtr data_;
-};
+  json::Value request(json::ValueType::TYPE_OBJECT);
+  addParams(request, params);
+  procedure.invoke(request);
+}
+
+void invokeProcedure(ProcedureReturn& procedure, json::Value& request,
+                     const Deadline& deadline, const RpcDoneCallback& done) {
+  checkDeadline(deadline, request["id"]);
+  Deadline::Scope scope(deadline);
+  procedure.invoke(request, done);
+}
+
+void invokeProcedure(ProcedureNotify& procedure, json::Value& request,
+                     const Deadline& deadline) {
+  checkDeadline(deadline);
+  Deadline::Scope scope(deadline);
+  procedure.invoke(request);
+}
+
+// timeout为整数, 与envelope中的其他字段一样, 类型或取值非法时交给json::Value的路径
+bool readTimeout(JsonCursor& cursor, int64_t& timeout) {
+  switch (cursor.peekType()) {
+    case json::ValueType::TYPE_INT32: {
+      int32_t value = 0;
+      if (!cursor.readInt32(value)) return false;
+      timeout = value;
+      break;
+    }
+    case json::ValueType::TYPE_INT64:
+      if (!cursor.readInt64(timeout)) return false;
+      break;
+    default:
+      return false;
+  }
+  return timeout >= 0;
+}
+
+// notify失败是无需给用户返回信息的，因此notify成功与否，用户都应该能接受其结果，用户逻辑不应依赖于notify的成功
+void warnNotifyError(RpcError err, const char* detail) {
+  WARN("notify error, code:{}, message:{}, data:{}", err.asCode(),
+       err.asString(), detail);
+}
+
+/* 只扫描request的外层字段, 各字段记录为body中的原始文本, params只确定边界, 不解析
+只接受形式规范的单个request/notify: object中只有jsonrpc, method, id, params, timeout且没有重复,
+jsonrpc和method为不含转义字符的string, id为整数或string, timeout为非负整数
+其余情况(batch, 语法错误, 多余或重复的字段, 字段类型错误等)返回false,
+由json::Value的路径处理并给出与之前相同的错误信息
+*/
+bool scanEnvelope(std::string_view body, RequestEnvelope& envelope) {
+  JsonCursor cursor(body);
+  if (cursor.peekType() != json::ValueType::TYPE_OBJECT) return false;
+  cursor.startObject();
+
+  std::string_view key;
+  while (cursor.nextMember(key)) {
+    if (key == "jsonrpc" && !envelope.hasVersion) {
+      envelope.hasVersion = cursor.readStringView(envelope.version);
+    } else if (key == "method" && !envelope.hasMethod) {
+      envelope.hasMethod = cursor.readStringView(envelope.method);
+    } else if (key == "id" && !envelope.hasId) {
+      envelope.idType = cursor.peekType();
+      if (envelope.idType != json::ValueType::TYPE_STRING &&
+          envelope.idType != json::ValueType::TYPE_INT32 &&
+          envelope.idType != json::ValueType::TYPE_INT64) {
+        return false;
+      }
+      envelope.hasId = cursor.skipValue(envelope.id);
+    } else if (key == "params" && !envelope.hasParams) {
+      envelope.hasParams = cursor.skipValue(envelope.params);
+    } else if (key == "timeout" && !envelope.hasTimeout) {
+      if (!readTimeout(cursor, envelope.timeout)) return false;
+      envelope.hasTimeout = true;
+    } else {
+      return false;
+    }
+  }
+  return !cursor.failed() && cursor.atEnd();
+}
 
 }  // anonymous namespace
 
 void RpcServer::addService(std::string_view serviceName, RpcService* service) {
+  assert(!started_ && "service must be added before start()");
   assert(services_.find(serviceName) == services_.end());
   services_.insert({serviceName, std::unique_ptr<RpcService>(service)});
 }
 
+void RpcServer::start() {
+  if (!started_) {
+    started_ = true;
+    if (numWorkerThreads_ > 0) {
+      ownedWorkers_ = std::make_unique<WorkStealingExecutor>(numWorkerThreads_,
+                                                             workerCpus_);
+      workers_ = ownedWorkers_.get();
+    } else {
+      workers_ = sharedExecutor_;
+    }
+    // 同名的request和notify合并为一项
+    std::map<std::string, MethodTable::Entry> merged;
+    for (auto& [serviceName, service] : services_) {
+      service->forEachProcedure([&](std::string_view methodName,
+                                    ProcedureReturn* procedureReturn,
+                                    ProcedureNotify* procedureNotify) {
+        std::string name;
+        name.append(serviceName).append(".").append(methodName);
+        auto& entry = merged[name];
+        entry.name = name;
+        if (procedureReturn != nullptr) {
+          entry.procedureReturn = procedureReturn;
+          bindExecutor(*procedureReturn, name);
+        }
+        if (procedureNotify != nullptr) {
+          entry.procedureNotify = procedureNotify;
+          bindExecutor(*procedureNotify, name);
+        }
+      });
+    }
+    std::vector<MethodTable::Entry> entries;
+    entries.reserve(merged.size());
+    for (auto& [name, entry] : merged) entries.push_back(std::move(entry));
+    methods_.build(std::move(entries));
+    DEBUG("RpcServer::start() {} methods in {} services", methods_.size(),
+          services_.size());
+  }
+  BaseServer::start();
+}
+
+void RpcServer::setWorkerThreads(size_t numThreads, std::vector<int> cpus) {
+  assert(!started_ && "worker threads must be set before start()");
+  numWorkerThreads_ = numThreads;
+  workerCpus_ = std::move(cpus);
+}
+
+// SHARED的method使用workers_, 没有调用setWorkerThreads()也没有共享的executor时按CPU核数创建
+// DEDICATED的method各自有一个executor, 只在其中的线程之间窃取
+template <typename Procedure>
+void RpcServer::bindExecutor(Procedure& procedure, const std::string& name) {
+  switch (procedure.executionPolicy()) {
+    case ExecutionPolicy::INLINE:
+      procedure.setExecutor(nullptr);
+      break;
+    case ExecutionPolicy::SHARED:
+      if (workers_ == nullptr) {
+        size_t numThreads =
+            std::max(1u, std::thread::hardware_concurrency());
+        ownedWorkers_ =
+            std::make_unique<WorkStealingExecutor>(numThreads, workerCpus_);
+        workers_ = ownedWorkers_.get();
+        DEBUG("RpcServer::start() {} shared worker threads", numThreads);
+      }
+      procedure.setExecutor(workers_);
+      break;
+    case ExecutionPolicy::DEDICATED:
+      dedicatedWorkers_.push_back(std::make_unique<WorkStealingExecutor>(
+          std::max<size_t>(1, procedure.dedicatedThreads())));
+      procedure.setExecutor(dedicatedWorkers_.back().get());
+      DEBUG("RpcServer::start() {} dedicated worker threads for {}",
+            procedure.dedicatedThreads(), name);
+      break;
+  }
+}
+
 // 通过BaseServer handleMessage时调用handleRequest, onMessage调用handleMessage
 // onMessage为BaseServer的回调  最终设置为ev::channel的回调 在有可读信号时被调用
 // 这里的done参数时BaseServer设置的lambda函数，调用sendResponse
-void RpcServer::handleRequest(const std::string& json,
+void RpcServer::handleRequest(std::string_view body, CodecId codec,
+                              Deadline::TimePoint received,
                               const RpcDoneCallback& done) {
-  // 将string反序列化为json格式的数据结构 并处理
-  json::Document request;
-  json::ParseError err = request.parse(json);
-  if (err != json::ParseError::PARSE_OK) {
-    throw RequestException(RpcError(ERROR::RPC_PARSE_ERROR),
-                           json::parseErrorString(err));
-  }
-  switch (request.getType()) {
-    case json::ValueType::TYPE_OBJECT:
-      if (isNotify(request)) {
-        handleSingleNotify(request);
+  try {
+    // JSON编码的单个request先只扫描外层字段, 找到procedure之后才解析params,
+    // 非法或找不到method的request不需要解析params
+    RequestEnvelope envelope;
+    if (codec == CodecId::JSON && scanEnvelope(body, envelope)) {
+      if (envelope.hasId) {
+        handleEnvelopeRequest(envelope, received, done);
       } else {
-        handleSingleRequest(request, done);
+        handleEnvelopeNotify(envelope, received);
       }
-      break;
-    case json::ValueType::TYPE_ARRAY:
-      handleBatchRequests(request, done);
-      break;
-    default:
-      throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                             "request should be json object or array");
+      return;
+    }
+
+    // 在buffer中原地反序列化为json格式的数据结构 并处理
+    // Document持有自己的数据, 不引用body, 因此异步执行的procedure不受buffer回收的影响
+    // batch中的request共用同一个收到的时间
+    json::Document request;
+    if (const char* err = parseBody(codec, body, request)) {
+      throw RequestException(RpcError(ERROR::RPC_PARSE_ERROR), err);
+    }
+    switch (request.getType()) {
+      case json::ValueType::TYPE_OBJECT:
+        if (isNotify(request)) {
+          handleSingleNotify(request, received);
+        } else {
+          handleSingleRequest(request, received, done);
+        }
+        break;
+      case json::ValueType::TYPE_ARRAY:
+        handleBatchRequests(request, received, done);
+        break;
+      default:
+        throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                               "request should be json object or array");
+    }
+  } catch (NotifyException& e) {
+    // 与batch中的notify相同, 失败时也没有response
+    warnNotifyError(e.err(), e.detail());
+  }
+}
+
+// 检查的顺序和错误信息与validateRequest相同, id的类型已由scanEnvelope保证,
+// 也没有多余的字段
+void RpcServer::handleEnvelopeRequest(const RequestEnvelope& envelope,
+                                      Deadline::TimePoint received,
+                                      const RpcDoneCallback& done) {
+  Deadline deadline;
+  if (envelope.hasTimeout) {
+    deadline = Deadline(received, std::chrono::milliseconds(envelope.timeout));
+  }
+  auto id = envelopeId(envelope);
+  if (!envelope.hasVersion) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST), id,
+                           "missing at least one field");
+  }
+  if (envelope.version != "2.0") {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST), id,
+                           "jsonrpc version must be 2.0");
+  }
+  if (!envelope.hasMethod) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST), id,
+                           "missing at least one field");
+  }
+  if (envelope.method == "rpc.") {
+    throw RequestException(RpcError(ERROR::RPC_METHOD_NOT_FOUND), id,
+                           "method name is internal use");
+  }
+
+  auto& procedure = findProcedureReturn(envelope.method, id);
+  auto executor = procedure.executor();
+  if (executor == nullptr) {
+    invokeEnvelope(procedure, envelope.params, envelope.id, std::move(id),
+                   deadline, done);
+    return;
   }
+
+  // envelope引用连接的输入buffer, 交给线程池之前复制params和id的原始文本
+  executor->runTask([this, &procedure, params = std::string(envelope.params),
+                     rawId = std::string(envelope.id), id = std::move(id),
+                     deadline, done]() mutable {
+    try {
+      invokeEnvelope(procedure, params, rawId, std::move(id), deadline, done);
+    } catch (RequestException& e) {
+      done(wrapException(e));
+    }
+  });
 }
 
-// 校验request并解析出service和method，调用service的callProcedureReturn方法
-// 该方法调用methodName对应的procedure
+// 与validateNotify相同, 缺少字段时抛出的是RequestException
+void RpcServer::handleEnvelopeNotify(const RequestEnvelope& envelope,
+                                     Deadline::TimePoint received) {
+  Deadline deadline;
+  if (envelope.hasTimeout) {
+    deadline = Deadline(received, std::chrono::milliseconds(envelope.timeout));
+  }
+  if (!envelope.hasVersion) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                           "missing at least one field");
+  }
+  if (envelope.version != "2.0") {
+    throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                          "jsonrpc version must be 2.0");
+  }
+  if (!envelope.hasMethod) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                           "missing at least one field");
+  }
+  if (envelope.method == "rpc.") {
+    throw NotifyException(RpcError(ERROR::RPC_METHOD_NOT_FOUND),
+                          "method name is internal use");
+  }
+
+  auto& procedure = findProcedureNotify(envelope.method);
+  auto executor = procedure.executor();
+  if (executor == nullptr) {
+    invokeEnvelope(procedure, envelope.params, deadline);
+    return;
+  }
+
+  executor->runTask([&procedure, params = std::string(envelope.params),
+                     deadline]() {
+    try {
+      invokeEnvelope(procedure, params, deadline);
+    } catch (NotifyException& e) {
+      warnNotifyError(e.err(), e.detail());
+    } catch (RequestException& e) {
+      warnNotifyError(e.err(), e.detail());
+    }
+  });
+}
+
+// 校验request并找到对应的procedure
 void RpcServer::handleSingleRequest(json::Value& request,
+                                    Deadline::TimePoint received,
                                     const RpcDoneCallback& done) {
-  validateRequest(request);
+  auto deadline = validateRequest(request, received);
+  auto& procedure =
+      findProcedureReturn(request["method"].getStringView(), request["id"]);
+  auto executor = procedure.executor();
+  if (executor == nullptr) {
+    invokeProcedure(procedure, request, deadline, done);
+    return;
+  }
+
+  // request属于调用者的Document或batch, 移出后由task持有
+  auto owned = makePooled<json::Value>(std::move(request));
+  executor->runTask([this, &procedure, owned, deadline, done]() {
+    try {
+      invokeProcedure(procedure, *owned, deadline, done);
+    } catch (RequestException& e) {
+      done(wrapException(e));
+    }
+  });
+}
+
+void RpcServer::handleSingleNotify(json::Value& request,
+                                   Deadline::TimePoint received) {
+  auto deadline = validateNotify(request, received);
+  auto& procedure = findProcedureNotify(request["method"].getStringView());
+  auto executor = procedure.executor();
+  if (executor == nullptr) {
+    invokeProcedure(procedure, request, deadline);
+    return;
+  }
+
+  auto owned = makePooled<json::Value>(std::move(request));
+  executor->runTask([&procedure, owned, deadline]() {
+    try {
+      invokeProcedure(procedure, *owned, deadline);
+    } catch (NotifyException& e) {
+      warnNotifyError(e.err(), e.detail());
+    }
+  });
+}
+
+// 格式为"method":"serviceName.methodName", 以全名在分发表中查找一次
+// 找不到时再按service和method两级查找, 给出具体的错误信息
+ProcedureReturn& RpcServer::findProcedureReturn(std::string_view methodName,
+                                                const json::Value& id) {
+  auto entry = methods_.find(methodName);
+  if (entry != nullptr && entry->procedureReturn != nullptr) {
+    return *entry->procedureReturn;
+  }
 
-  auto& id = request["id"];
-  auto methodName = request["method"].getStringView();
   auto pos = methodName.find('.');
-  // 格式为"method":"serviceName.methodName"
   if (pos == std::string_view::npos || pos == 0) {
     throw RequestException(RpcError(ERROR::RPC_METHOD_NOT_FOUND), id,
                            "missing service name in method");
@@ -164,59 +613,21 @@ void RpcServer::handleSingleRequest(json::Value& request,
                            "missing method name in method field");
   }
 
-  auto& service = it->second;
-  service->callProcedureReturn(methodName, request, done);
-}
-
-void RpcServer::handleBatchRequests(json::Value& requests,
-                                    const RpcDoneCallback& done) {
-  size_t num = requests.getSize();
-  if (num == 0) {
-    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                           "batch request is empty");
-  }
-
-  // 可能存在竞态的点，因此用线程安全的自定义数据类型来存储结果responses的集合
-  ThreadSafeBatchResponse responses(done);
-  try {
-    size_t n = requests.getSize();
-    for (size_t i = 0; i < n; ++i) {
-      auto& request = requests[i];
-
-      if (!request.isObject()) {
-        throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
-                               "request should be json object");
-      }
-      if (isNotify(request)) {
-        handleSingleNotify(request);
-      } else {
-        // handleSingleRequest的done参数为lambda函数
-        // 执行handleSingleRequest调用完method之后，通过done将结果response添加进结果集当中
-        // 当所有的request都执行完后，在ThreadSafeBatchResponse responses析构时
-        // 再调用handleBatchRequests函数的done参数来处理结果集
-        // 线程安全，由于method调用时存在静态，结果集responses为临界区
-        handleSingleRequest(request, [&](json::Value response) {
-          responses.addResponse(response);
-        });
-      }
-    }
-  } catch (RequestException& e) {
-    // 失败信息也加入结果集
-    auto response = wrapException(e);
-    responses.addResponse(response);
-  } catch (NotifyException& e) {
-    // notify失败是无需给用户返回信息的，因此notify成功与否，用户都应该能接受其结果，用户逻辑不应依赖于notify的成功
-    WARN("notify error, code:{}, message:{}, data:{}", e.err().asCode(),
-         e.err().asString(), e.detail());
+  auto procedure = it->second->findProcedureReturn(methodName);
+  if (procedure == nullptr) {
+    throw RequestException(RpcError(ERROR::RPC_METHOD_NOT_FOUND), id,
+                           "method not found");
   }
+  return *procedure;
 }
 
-void RpcServer::handleSingleNotify(json::Value& request) {
-  validateNotify(request);
+ProcedureNotify& RpcServer::findProcedureNotify(std::string_view methodName) {
+  auto entry = methods_.find(methodName);
+  if (entry != nullptr && entry->procedureNotify != nullptr) {
+    return *entry->procedureNotify;
+  }
 
-  // 找到匹配的service.method
-  auto methodName = request["method"].getStringView();
-  auto pos = methodName.find(".");
+  auto pos = methodName.find('.');
   if (pos == std::string_view::npos || pos == 0) {
     throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
                           "missing service name in method field");
@@ -233,13 +644,83 @@ void RpcServer::handleSingleNotify(json::Value& request) {
   if (methodName.size() == 0) {
     throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
                           "missing method name in method field");
-    auto& service = it->second;
-    service->callProcedureNotify(methodName, request);
   }
+
+  auto procedure = it->second->findProcedureNotify(methodName);
+  if (procedure == nullptr) {
+    throw NotifyException(RpcError(ERROR::RPC_METHOD_NOT_FOUND),
+                          "method not found");
+  }
+  return *procedure;
 }
 
-// 确认request合法
-void RpcServer::validateRequest(json::Value& request) {
+void RpcServer::handleBatchRequests(json::Value& requests,
+                                    Deadline::TimePoint received,
+                                    const RpcDoneCallback& done) {
+  size_t num = requests.getSize();
+  if (num == 0) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                           "batch request is empty");
+  }
+
+  // request可能在线程池中异步完成, 结果集由各个request的done共同持有
+  auto responses = makePooled<BatchResponse>(num, done);
+  if (workers_ == nullptr || batchChunkSize_ == 0 || num <= batchChunkSize_) {
+    handleBatchChunk(requests, 0, num, received, responses);
+    return;
+  }
+
+  // requests属于调用者的Document, 移出后由各组的task共同持有
+  auto batch = makePooled<json::Value>(std::move(requests));
+  for (size_t begin = 0; begin < num; begin += batchChunkSize_) {
+    size_t end = std::min(num, begin + batchChunkSize_);
+    workers_->runTask([this, batch, responses, begin, end, received]() {
+      try {
+        handleBatchChunk(*batch, begin, end, received, responses);
+      } catch (std::exception& e) {
+        // 本组剩余的slot不再完成, 最后一个引用析构时交出已有的结果
+        ERROR("RpcServer::handleBatchChunk() {}", e.what());
+      }
+    });
+  }
+}
+
+// 每个request单独处理, 失败信息写入自己的slot, 不影响同一batch中的其他request
+void RpcServer::handleBatchChunk(
+    json::Value& requests, size_t begin, size_t end,
+    Deadline::TimePoint received,
+    const std::shared_ptr<BatchResponse>& responses) {
+  for (size_t i = begin; i < end; ++i) {
+    auto& request = requests[i];
+    try {
+      if (!request.isObject()) {
+        throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                               "request should be json object");
+      }
+      if (isNotify(request)) {
+        handleSingleNotify(request, received);
+        responses->skip();
+      } else {
+        // method调用完成后通过done把response写入第i个slot
+        // batch中的request都经过json::Value的路径, response不会是body形式
+        handleSingleRequest(request, received,
+                            [responses, i](const RpcResponse& response) {
+                              responses->set(i, response.toValue());
+                            });
+      }
+    } catch (RequestException& e) {
+      // 失败信息也加入结果集
+      responses->set(i, wrapException(e));
+    } catch (NotifyException& e) {
+      warnNotifyError(e.err(), e.detail());
+      responses->skip();
+    }
+  }
+}
+
+// 确认request合法, 返回request的截止时间
+Deadline RpcServer::validateRequest(json::Value& request,
+                                    Deadline::TimePoint received) {
   auto& id =
       findValue<json::ValueType::TYPE_STRING, json::ValueType::TYPE_INT32,
                 json::ValueType::TYPE_INT64>(request, "id");
@@ -257,14 +738,22 @@ void RpcServer::validateRequest(json::Value& request) {
                            "method name is internal use");
   }
 
-  size_t nMembers = 3u + hasParams(request);
+  Deadline deadline;
+  if (!findDeadline(request, received, deadline)) {
+    throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST), id,
+                           "timeout must be non-negative integer");
+  }
+
+  size_t nMembers = 3u + hasParams(request) + deadline.has();
 
   if (request.getSize() != nMembers) {
     throw RequestException(RpcError(ERROR::RPC_INVALID_REQUEST), id,
                            "unexpected field");
   }
+  return deadline;
 }
-void RpcServer::validateNotify(json::Value& request) {
+Deadline RpcServer::validateNotify(json::Value& request,
+                                   Deadline::TimePoint received) {
   auto& version = findValue<json::ValueType::TYPE_STRING>(request, "jsonrpc");
   if (version.getStringView() != "2.0") {
     throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
@@ -277,12 +766,19 @@ void RpcServer::validateNotify(json::Value& request) {
                           "method name is internal use");
   }
 
-  size_t nMembers = 2u + hasParams(request);
+  Deadline deadline;
+  if (!findDeadline(request, received, deadline)) {
+    throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
+                          "timeout must be non-negative integer");
+  }
+
+  size_t nMembers = 2u + hasParams(request) + deadline.has();
 
   if (request.getSize() != nMembers) {
     throw NotifyException(RpcError(ERROR::RPC_INVALID_REQUEST),
                           "unexpected field");
   }
+  return deadline;
 }
 }  // namespace rpc
 }  // namespace goa
\ No newline at end of file
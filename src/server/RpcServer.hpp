@@ -1,41 +1,113 @@
 #pragma once
 #include <memory>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "goa-json/include/Value.hpp"
 #include "server/BaseServer.hpp"
+#include "server/MethodTable.hpp"
 #include "server/RpcService.hpp"
+#include "utils/Deadline.hpp"
+#include "utils/WorkStealingExecutor.hpp"
 #include "utils/utils.hpp"
 
 namespace goa {
 
 namespace rpc {
 
+struct RequestEnvelope;
+class BatchResponse;
+
 // RpcServer管理RpcService，RpcService管理Procedure
 class RpcServer : public BaseServer<RpcServer> {
  public:
   RpcServer(EventLoop* loop, const InetAddress& local)
       : BaseServer(loop, local) {}
+  RpcServer(EventLoop* loop, const InetAddress& local, bool reusePort,
+            IoBackend backend = IoBackend::EPOLL)
+      : BaseServer(loop, local, reusePort, backend) {}
+  RpcServer(EventLoop* loop, const UnixAddress& local)
+      : BaseServer(loop, local) {}
+  RpcServer(EventLoop* loop, const ShmAddress& local)
+      : BaseServer(loop, local) {}
 
   ~RpcServer() = default;
 
+  // 在start()之前注册
   void addService(std::string_view serviceName, RpcService* service);
 
+  // 冻结service注册表并构建分发表, 然后开始接受连接
+  void start();
+
+  // server共享的工作线程, 在start()之前设置, 默认没有
+  // 用于batch的分组以及执行策略为SHARED的method, cpus非空时第i个worker绑定到cpus[i % cpus.size()]
+  void setWorkerThreads(size_t numThreads, std::vector<int> cpus = {});
+
+  // 以外部的executor作为共享的工作线程, 在start()之前设置, 它需要在server析构后才停止
+  // ShardedRpcServer用它让所有shard共用一组线程, 同时调用了setWorkerThreads()时以后者为准
+  void setSharedExecutor(WorkStealingExecutor* executor) {
+    sharedExecutor_ = executor;
+  }
+
+  // 共享的工作窃取executor, 在start()中创建, 没有设置工作线程也没有SHARED的method时为nullptr
+  // service的实现可以把耗时的任务交给它, 与其他service共用同一组线程
+  WorkStealingExecutor* executor() const { return workers_; }
+  // batch中每chunkSize个request为一组, 各组在工作线程池中并行处理, response仍按request的顺序
+  // 0(默认)、没有工作线程池或者batch不超过一组时在IO线程中依次处理
+  void setBatchChunkSize(size_t chunkSize) { batchChunkSize_ = chunkSize; }
+
   // 通过BaseServer 将其加入onMessage 并设置为server的回调
   // 最终设置为ev::channel的回调 在有可读信号时被调用
-  void handleRequest(const std::string& json, const RpcDoneCallback& done);
+  // body指向连接的输入buffer, 只在本次调用期间有效, 以codec解码
+  // received为该帧读到的时间, request中的timeout从此时开始计算, 包括在连接上排队的时间
+  void handleRequest(std::string_view body, CodecId codec,
+                     Deadline::TimePoint received, const RpcDoneCallback& done);
 
  private:
-  void handleSingleRequest(json::Value& request, const RpcDoneCallback& done);
-  void handleBatchRequests(json::Value& request, const RpcDoneCallback& done);
-  void handleSingleNotify(json::Value& request);
+  void handleEnvelopeRequest(const RequestEnvelope& envelope,
+                             Deadline::TimePoint received,
+                             const RpcDoneCallback& done);
+  void handleEnvelopeNotify(const RequestEnvelope& envelope,
+                            Deadline::TimePoint received);
+  // received为收到request的时间, request中的timeout从此时开始计算
+  void handleSingleRequest(json::Value& request, Deadline::TimePoint received,
+                           const RpcDoneCallback& done);
+  void handleBatchRequests(json::Value& request, Deadline::TimePoint received,
+                           const RpcDoneCallback& done);
+  void handleBatchChunk(json::Value& requests, size_t begin, size_t end,
+                        Deadline::TimePoint received,
+                        const std::shared_ptr<BatchResponse>& responses);
+  void handleSingleNotify(json::Value& request, Deadline::TimePoint received);
+
+  // 找不到时抛出异常
+  ProcedureReturn& findProcedureReturn(std::string_view methodName,
+                                       const json::Value& id);
+  ProcedureNotify& findProcedureNotify(std::string_view methodName);
+
+  // 返回request的截止时间, 没有timeout字段时has()为false
+  Deadline validateRequest(json::Value& request, Deadline::TimePoint received);
+  Deadline validateNotify(json::Value& request, Deadline::TimePoint received);
 
-  void validateRequest(json::Value& request);
-  void validateNotify(json::Value& request);
+  // 按procedure的执行策略设置它的线程池
+  template <typename Procedure>
+  void bindExecutor(Procedure& procedure, const std::string& name);
 
   using RpcServicePtr = std::unique_ptr<RpcService>;
   using ServiceList = std::unordered_map<std::string_view, RpcServicePtr>;
   ServiceList services_;
+  MethodTable methods_;  // start()时由services_构建
+  bool started_ = false;
+  size_t numWorkerThreads_ = 0;
+  std::vector<int> workerCpus_;
+  WorkStealingExecutor* sharedExecutor_ = nullptr;
+  // ownedWorkers_或sharedExecutor_
+  WorkStealingExecutor* workers_ = nullptr;
+  // 析构时先于services_停止, executor中的task仍可能引用procedure
+  std::unique_ptr<WorkStealingExecutor> ownedWorkers_;
+  std::vector<std::unique_ptr<WorkStealingExecutor>> dedicatedWorkers_;
+  size_t batchChunkSize_ = 0;
 };
 
 }  // namespace rpc
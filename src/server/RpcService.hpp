@@ -28,24 +28,26 @@ class RpcService : noncopyable {
         {methodName, std::unique_ptr<ProcedureNotify>(p)});
   }
 
-  void callProcedureReturn(std::string_view methodName, json::Value& request,
-                           const RpcDoneCallback& done) {
+  // 找不到时返回nullptr
+  ProcedureReturn* findProcedureReturn(std::string_view methodName) const {
     auto it = procedureReturnList_.find(methodName);
-    if (it == procedureReturnList_.end()) {
-      throw RequestException(RpcError(ERROR::RPC_METHOD_NOT_FOUND),
-                             request["id"], "method not found");
-    }
-    it->second->invoke(request, done);
+    return it == procedureReturnList_.end() ? nullptr : it->second.get();
   }
 
-  // notify无需callback，无返回
-  void callProcedureNotify(std::string_view methodName, json::Value& request) {
+  ProcedureNotify* findProcedureNotify(std::string_view methodName) const {
     auto it = procedureNotifyList_.find(methodName);
-    if (it == procedureNotifyList_.end()) {
-      throw NotifyException(RpcError(ERROR::RPC_METHOD_NOT_FOUND),
-                            "method not found");  // 同上
+    return it == procedureNotifyList_.end() ? nullptr : it->second.get();
+  }
+
+  // 遍历所有procedure, 用于RpcServer构建分发表
+  template <typename Func>
+  void forEachProcedure(Func&& func) const {
+    for (auto& [methodName, procedure] : procedureReturnList_) {
+      func(methodName, procedure.get(), static_cast<ProcedureNotify*>(nullptr));
+    }
+    for (auto& [methodName, procedure] : procedureNotifyList_) {
+      func(methodName, static_cast<ProcedureReturn*>(nullptr), procedure.get());
     }
-    it->second->invoke(request);
   }
 
  private:
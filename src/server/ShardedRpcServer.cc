@@ -0,0 +1,79 @@
+#include "server/ShardedRpcServer.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+ShardedRpcServer::ShardedRpcServer(const InetAddress& local, size_t numShards,
+                                   const ShardInitCallback& callback)
+    : local_(local),
+      numShards_(numShards),
+      initCallback_(callback),
+      backend_(IoBackend::EPOLL),
+      numWorkerThreads_(std::max(1u, std::thread::hardware_concurrency())),
+      started_(false),
+      loopsExited_(static_cast<int>(numShards)),
+      executorStopped_(1) {
+  assert(numShards_ > 0);
+}
+
+ShardedRpcServer::~ShardedRpcServer() {
+  if (!started_) return;
+  /* 先退出所有shard的loop, 已排队的回调(关闭连接、合并发送、io_uring的提交等)
+  引用着server, loop退出后不再执行, server析构之后也就不会被它们访问
+  executor中的task可能引用任意shard的procedure, 所有loop退出后不再提交新的task,
+  等executor执行完已提交的task, 各shard再在自己的线程中析构server
+  */
+  for (auto& shard : shards_) {
+    // loop()开始时会清除quit标志, 因此在loop中调用quit()
+    auto loop = shard.loop;
+    loop->queueInLoop([loop]() { loop->quit(); });
+  }
+  loopsExited_.wait();
+  executor_.reset();
+  executorStopped_.count();
+  for (auto& shard : shards_) shard.thread.join();
+}
+
+void ShardedRpcServer::start() {
+  if (started_) return;
+  started_ = true;
+
+  executor_ =
+      std::make_unique<WorkStealingExecutor>(numWorkerThreads_, workerCpus_);
+  shards_.resize(numShards_);
+  for (size_t i = 0; i < numShards_; i++) {
+    CountDownLatch started(1);
+    shards_[i].thread =
+        std::thread([this, i, &started]() { runShard(i, started); });
+    started.wait();
+  }
+  INFO("ShardedRpcServer::start() {} with {} shards, {} worker threads",
+       local_.toIpPort(), numShards_, numWorkerThreads_);
+}
+
+void ShardedRpcServer::runShard(size_t index, CountDownLatch& started) {
+  EventLoop loop;
+  // 每个shard绑定同一地址, 各自listen, 在start之前注册service
+  auto server = std::make_unique<RpcServer>(&loop, local_, true, backend_);
+  server->setSharedExecutor(executor_.get());
+  initCallback_(*server, index);
+  server->start();
+  shards_[index].loop = &loop;
+  started.count();
+
+  loop.loop();
+
+  loopsExited_.count();
+  executorStopped_.wait();
+  server.reset();
+}
+
+}  // namespace rpc
+
+}  // namespace goa
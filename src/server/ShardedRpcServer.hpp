@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "server/RpcServer.hpp"
+#include "utils/WorkStealingExecutor.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* shared-nothing的多线程server
+启动numShards个互相独立的shard, 每个shard有自己的IO线程、EventLoop、监听socket和RpcServer,
+监听socket都设置SO_REUSEPORT并绑定同一地址, 由内核把连接哈希到各个shard,
+request从收到到回复都只在所属shard的线程中处理, 不访问其他shard的任何状态
+service也按shard各注册一份, 因此service的实现同样不需要跨线程同步
+执行策略为SHARED的method和batch的分组在所有shard共用的一个WorkStealingExecutor中执行,
+线程总数不随shard数增加
+每个shard的EventLoop和RpcServer都在该shard的线程中创建, loop退出之后才在同一线程中析构server,
+与在main中先退出loop再析构RpcServer的顺序相同, 已排队的回调不会在server析构之后执行
+*/
+class ShardedRpcServer : noncopyable {
+ public:
+  // 在start()中为每个shard调用一次, 用于在该shard的RpcServer上注册service,
+  // 也可以在此设置FlushPolicy等选项. 注册的service对象需要在ShardedRpcServer析构前保持有效
+  // 在该shard的线程中调用, 各shard依次调用, 不会并发
+  using ShardInitCallback = std::function<void(RpcServer& server, size_t index)>;
+
+  ShardedRpcServer(const InetAddress& local, size_t numShards,
+                   const ShardInitCallback& callback);
+  ~ShardedRpcServer();
+
+  // 在start()之前设置, 所有shard使用相同的IO方式
+  void setIoBackend(IoBackend backend) { backend_ = backend; }
+  // 所有shard共用的工作线程, 在start()之前设置, 默认为CPU核数
+  // cpus非空时第i个worker绑定到cpus[i % cpus.size()]
+  void setWorkerThreads(size_t numThreads, std::vector<int> cpus = {}) {
+    numWorkerThreads_ = numThreads;
+    workerCpus_ = std::move(cpus);
+  }
+
+  void start();
+
+  size_t numShards() const { return numShards_; }
+
+ private:
+  struct Shard {
+    std::thread thread;
+    EventLoop* loop = nullptr;  // 位于shard线程的栈上, 线程退出前有效
+  };
+
+  // shard线程的主函数, server创建并start()之后started计数
+  void runShard(size_t index, CountDownLatch& started);
+
+  InetAddress local_;
+  size_t numShards_;
+  ShardInitCallback initCallback_;
+  IoBackend backend_;
+  size_t numWorkerThreads_;
+  std::vector<int> workerCpus_;
+  bool started_;
+  std::unique_ptr<WorkStealingExecutor> executor_;
+  std::vector<Shard> shards_;
+  // 析构时所有shard的loop都已退出, 以及executor已停止, 之后各shard才析构自己的server
+  CountDownLatch loopsExited_;
+  CountDownLatch executorStopped_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
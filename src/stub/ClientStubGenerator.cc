@@ -30,18 +30,21 @@ public:
     [stubClassName](EventLoop* loop, const InetAddress& serverAddress):
             client_(loop, serverAddress)
     {
-        client_.setConnectionCallback([this](const TcpConnectionPtr& conn){
-            if (conn->connected()) {
-                INFO("connected");
-                conn_ = conn;
-                cb_(conn_);
-            }
-            else {
-                INFO("disconnected");
-                assert(conn_ != nullptr);
-                cb_(conn_);
-            }
-        });
+        init();
+    }
+
+    // 同一主机上的服务端可以通过Unix domain socket连接
+    [stubClassName](EventLoop* loop, const UnixAddress& serverAddress):
+            client_(loop, serverAddress)
+    {
+        init();
+    }
+
+    // 同一主机上的服务端也可以通过共享内存连接
+    [stubClassName](EventLoop* loop, const ShmAddress& serverAddress):
+            client_(loop, serverAddress)
+    {
+        init();
     }
 
     ~[stubClassName]() = default;
@@ -53,10 +56,29 @@ public:
         cb_ = cb;
     }
 
+    void setFramingMode(FramingMode mode) { client_.setFramingMode(mode); }
+    void setCodec(CodecId codec) { client_.setCodec(codec); }
+
     [procedureDefinitions]
     [notifyDefinitions]
 
 private:
+    void init()
+    {
+        client_.setConnectionCallback([this](const TcpConnectionPtr& conn){
+            if (conn->connected()) {
+                INFO("connected");
+                conn_ = conn;
+                cb_(conn_);
+            }
+            else {
+                INFO("disconnected");
+                assert(conn_ != nullptr);
+                cb_(conn_);
+            }
+        });
+    }
+
     TcpConnectionPtr conn_;
     ConnectionCallback cb_;
     BaseClient client_;
@@ -18,9 +18,12 @@ std::string serviceStubTemplate(const std::string& macroName,
 #pragma once
 
 #include <goa-json/include/Value.hpp>
+#include <string>
+#include <string_view>
 
 #include "server/RpcServer.hpp"
 #include "server/RpcService.hpp"
+#include "utils/JsonCursor.hpp"
 #include "utils/utils.hpp"
 
 class [userClassName];
@@ -33,7 +36,7 @@ template <typename S>
 class [stubClassName]: noncopyable
 {
 protected:
-    explicit [stubClassName](RpcServer& server) {
+    explicit [stubClassName](RpcServer& server): server_(server) {
         static_assert(std::is_same_v<S, [userClassName]>,
                       "derived class name should be '[userClassName]'");
 
@@ -46,6 +49,11 @@ protected:
 
     ~[stubClassName]() = default;
 
+    // server共享的工作窃取executor, 在server.start()之后有效, 没有时为nullptr
+    WorkStealingExecutor* executor() const {
+        return server_.executor();
+    }
+
 private:
     [stubProcedureDefinitions]
 
@@ -53,6 +61,8 @@ private:
     S& convert() {
         return static_cast<S&>(*this);
     }
+
+    RpcServer& server_;
 };
 
 }
@@ -73,38 +83,79 @@ private:
 std::string stubProcedureBindTemplate(const std::string& procedureName,
                                       const std::string& stubClassName,
                                       const std::string& stubProcedureName,
-                                      const std::string& procedureParams) {
+                                      const std::string& procedureParams,
+                                      const std::string& typedBinding,
+                                      const std::string& executionBinding) {
   std::string str =
       R"(
-service->addProcedureReturn("[procedureName]", new ProcedureReturn(
+{
+    auto procedure = new ProcedureReturn(
         std::bind(&[stubClassName]::[stubProcedureName], this, _1, _2)
         [procedureParams]
-));
+    );
+    [typedBinding]
+    [executionBinding]
+    service->addProcedureReturn("[procedureName]", procedure);
+}
 )";
 
   replaceAll(str, "[procedureName]", procedureName);
   replaceAll(str, "[stubClassName]", stubClassName);
   replaceAll(str, "[stubProcedureName]", stubProcedureName);
   replaceAll(str, "[procedureParams]", procedureParams);
+  replaceAll(str, "[typedBinding]", typedBinding);
+  replaceAll(str, "[executionBinding]", executionBinding);
   return str;
 }
 
 std::string stubNotifyBindTemplate(const std::string& notifyName,
                                    const std::string& stubClassName,
                                    const std::string& stubNotifyName,
-                                   const std::string& notifyParams) {
+                                   const std::string& notifyParams,
+                                   const std::string& typedBinding,
+                                   const std::string& executionBinding) {
   std::string str =
       R"(
-service->addProcedureNotify("[notifyName]", new ProcedureNotify(
+{
+    auto procedure = new ProcedureNotify(
         std::bind(&[stubClassName]::[stubNotifyName], this, _1)
         [notifyParams]
-));
+    );
+    [typedBinding]
+    [executionBinding]
+    service->addProcedureNotify("[notifyName]", procedure);
+}
 )";
 
   replaceAll(str, "[notifyName]", notifyName);
   replaceAll(str, "[stubClassName]", stubClassName);
   replaceAll(str, "[stubNotifyName]", stubNotifyName);
   replaceAll(str, "[notifyParams]", notifyParams);
+  replaceAll(str, "[typedBinding]", typedBinding);
+  replaceAll(str, "[executionBinding]", executionBinding);
+  return str;
+}
+
+std::string typedBindTemplate(const std::string& stubClassName,
+                              const std::string& typedStubName,
+                              const std::string& placeholders) {
+  std::string str =
+      R"(procedure->setTypedCallback(std::bind(&[stubClassName]::[typedStubName], this, [placeholders]));)";
+
+  replaceAll(str, "[stubClassName]", stubClassName);
+  replaceAll(str, "[typedStubName]", typedStubName);
+  replaceAll(str, "[placeholders]", placeholders);
+  return str;
+}
+
+// 缺省的INLINE不需要设置
+std::string executionBindTemplate(const std::string& policy,
+                                  const std::string& numThreads) {
+  std::string str =
+      R"(procedure->setExecution(ExecutionPolicy::[policy], [numThreads]);)";
+
+  replaceAll(str, "[policy]", policy);
+  replaceAll(str, "[numThreads]", numThreads);
   return str;
 }
 
@@ -162,11 +213,11 @@ void [stubNotifyName](json::Value& request)
 
     if (params.isArray()) {
         [paramsFromJsonArray]
-        convert().[NotifyName]([notifyArgs]);
+        convert().[notifyName]([notifyArgs]);
     }
     else {
         [paramsFromJsonObject]
-        convert().[NotifyName]([notifyArgs]);
+        convert().[notifyName]([notifyArgs]);
     }
 }
 )";
@@ -193,6 +244,65 @@ void [stubNotifyName](json::Value& request) {
   return str;
 }
 
+// typed codec: 参数直接从params的原始JSON文本读入局部变量, response直接序列化
+std::string typedProcedureDefineTemplate(const std::string& typedStubName,
+                                         const std::string& typedParamsRead,
+                                         const std::string& procedureName,
+                                         const std::string& procedureArgs) {
+  std::string str =
+      R"(
+bool [typedStubName](std::string_view params, std::string_view id, const RpcDoneCallback& done) {
+    [typedParamsRead]
+    convert().[procedureName]([procedureArgs] UserDoneCallback(id, done));
+    return true;
+}
+)";
+
+  replaceAll(str, "[typedStubName]", typedStubName);
+  replaceAll(str, "[typedParamsRead]", typedParamsRead);
+  replaceAll(str, "[procedureName]", procedureName);
+  replaceAll(str, "[procedureArgs]", procedureArgs);
+  return str;
+}
+
+std::string typedNotifyDefineTemplate(const std::string& typedStubName,
+                                      const std::string& typedParamsRead,
+                                      const std::string& notifyName,
+                                      const std::string& notifyArgs) {
+  std::string str =
+      R"(
+bool [typedStubName](std::string_view params) {
+    [typedParamsRead]
+    convert().[notifyName]([notifyArgs]);
+    return true;
+}
+)";
+
+  replaceAll(str, "[typedStubName]", typedStubName);
+  replaceAll(str, "[typedParamsRead]", typedParamsRead);
+  replaceAll(str, "[notifyName]", notifyName);
+  replaceAll(str, "[notifyArgs]", notifyArgs);
+  return str;
+}
+
+// typed codec支持的参数类型对应的C++类型, 不支持时返回nullptr
+const char* typedParamType(goa::json::ValueType type) {
+  switch (type) {
+    case goa::json::ValueType::TYPE_BOOL:
+      return "bool";
+    case goa::json::ValueType::TYPE_INT32:
+      return "int32_t";
+    case goa::json::ValueType::TYPE_INT64:
+      return "int64_t";
+    case goa::json::ValueType::TYPE_DOUBLE:
+      return "double";
+    case goa::json::ValueType::TYPE_STRING:
+      return "std::string";
+    default:
+      return nullptr;  // object和array仍需要json::Value
+  }
+}
+
 std::string argsDefineTemplate(const std::string& arg, const std::string& index,
                                goa::json::ValueType type) {
   std::string str = R"(auto [arg] = params[[index]][method];)";
@@ -263,9 +373,15 @@ std::string ServiceStubGenerator::genStubProcedureBindings() {
     auto stubClassName = genStubClassName();
     auto stubProcedureName = genStubGenericName(p);
     auto procedureParams = genGenericParams(p);
-
-    auto binding = stubProcedureBindTemplate(
-        procedureName, stubClassName, stubProcedureName, procedureParams);
+    auto typedBinding =
+        hasTypedParams(p) ? typedBindTemplate(stubClassName,
+                                              genStubTypedName(p), "_1, _2, _3")
+                          : "";
+
+    auto binding =
+        stubProcedureBindTemplate(procedureName, stubClassName,
+                                  stubProcedureName, procedureParams,
+                                  typedBinding, genExecutionBinding(p));
     result.append(binding);
     result.append("\n");
   }
@@ -295,6 +411,15 @@ std::string ServiceStubGenerator::genStubProcedureDefinitions() {
       result.append(define);
       result.append("\n");
     }
+
+    if (hasTypedParams(r)) {
+      auto define = typedProcedureDefineTemplate(
+          genStubTypedName(r), genTypedParamsRead(r), procedureName,
+          genGenericArgs(r));
+
+      result.append(define);
+      result.append("\n");
+    }
   }
   return result;
 }
@@ -306,9 +431,14 @@ std::string ServiceStubGenerator::genStubNotifyBindings() {
     auto stubClassName = genStubClassName();
     auto stubNotifyName = genStubGenericName(p);
     auto notifyParams = genGenericParams(p);
+    auto typedBinding =
+        hasTypedParams(p)
+            ? typedBindTemplate(stubClassName, genStubTypedName(p), "_1")
+            : "";
 
     auto binding = stubNotifyBindTemplate(notifyName, stubClassName,
-                                          stubNotifyName, notifyParams);
+                                          stubNotifyName, notifyParams,
+                                          typedBinding, genExecutionBinding(p));
     result.append(binding);
     result.append("\n");
   }
@@ -324,7 +454,7 @@ std::string ServiceStubGenerator::genStubNotifyDefinitions() {
     if (r.params_.getSize() > 0) {
       auto paramsFromJsonArray = genParamsFromJsonArray(r);
       auto paramsFromJsonObject = genParamsFromJsonObject(r);
-      auto notifyArgs = genGenericArgs(r);
+      auto notifyArgs = genNotifyArgs(r);
       auto define =
           stubNotifyDefineTemplate(paramsFromJsonArray, paramsFromJsonObject,
                                    stubNotifyName, notifyName, notifyArgs);
@@ -337,6 +467,15 @@ std::string ServiceStubGenerator::genStubNotifyDefinitions() {
       result.append(define);
       result.append("\n");
     }
+
+    if (hasTypedParams(r)) {
+      auto define = typedNotifyDefineTemplate(
+          genStubTypedName(r), genTypedParamsRead(r), notifyName,
+          genNotifyArgs(r));
+
+      result.append(define);
+      result.append("\n");
+    }
   }
   return result;
 }
@@ -346,6 +485,57 @@ std::string ServiceStubGenerator::genStubGenericName(const Rpc& r) {
   return r.name_ + "Stub";
 }
 
+template <typename Rpc>
+std::string ServiceStubGenerator::genStubTypedName(const Rpc& r) {
+  return r.name_ + "TypedStub";
+}
+
+template <typename Rpc>
+std::string ServiceStubGenerator::genExecutionBinding(const Rpc& r) {
+  auto& execution = r.execution_;
+  if (execution.policy_ == "INLINE") return "";
+  return executionBindTemplate(execution.policy_,
+                               std::to_string(execution.numThreads_));
+}
+
+// 参数都是基本类型时才生成typed codec, 否则只有json::Value的路径
+template <typename Rpc>
+bool ServiceStubGenerator::hasTypedParams(const Rpc& r) {
+  for (auto& m : r.params_.getObject()) {
+    if (typedParamType(m.value.getType()) == nullptr) return false;
+  }
+  return true;
+}
+
+// 生成代码： double lhs; double rhs;
+//          if (!readTypedParams(params, {"lhs", "rhs"}, lhs, rhs)) return false;
+// 没有参数时request中不能有params
+template <typename Rpc>
+std::string ServiceStubGenerator::genTypedParamsRead(const Rpc& r) {
+  if (r.params_.getSize() == 0) {
+    return "if (!params.empty()) return false;";
+  }
+
+  std::string result;
+  std::string names;
+  std::string args;
+  for (auto& m : r.params_.getObject()) {
+    auto arg = m.key.getString();
+    result.append(typedParamType(m.value.getType()))
+        .append(" ")
+        .append(arg)
+        .append("{};\n");
+    names.append(names.empty() ? "" : ", ").append("\"" + arg + "\"");
+    args.append(", ").append(arg);
+  }
+  result.append("if (!readTypedParams(params, {")
+      .append(names)
+      .append("}")
+      .append(args)
+      .append(")) return false;");
+  return result;
+}
+
 // 生成的格式： "keyName",ValueType 多行表示
 template <typename Rpc>
 std::string ServiceStubGenerator::genGenericParams(const Rpc& r) {
@@ -395,6 +585,14 @@ std::string ServiceStubGenerator::genGenericArgs(const Rpc& r) {
   return result;
 }
 
+// notify没有UserDoneCallback, 去掉末尾的", "
+template <typename Rpc>
+std::string ServiceStubGenerator::genNotifyArgs(const Rpc& r) {
+  auto result = genGenericArgs(r);
+  if (!result.empty()) result.resize(result.size() - 2);
+  return result;
+}
+
 // 生成代码： auto paramName = param[index].getXXX(); XXX为对应的ValueType
 template <typename Rpc>
 std::string ServiceStubGenerator::genParamsFromJsonArray(const Rpc& r) {
@@ -24,9 +24,19 @@ class ServiceStubGenerator : public StubGenerator {
   template <typename Rpc>
   std::string genStubGenericName(const Rpc& r);
   template <typename Rpc>
+  std::string genStubTypedName(const Rpc& r);
+  template <typename Rpc>
+  bool hasTypedParams(const Rpc& r);
+  template <typename Rpc>
+  std::string genExecutionBinding(const Rpc& r);
+  template <typename Rpc>
+  std::string genTypedParamsRead(const Rpc& r);
+  template <typename Rpc>
   std::string genGenericParams(const Rpc& r);
   template <typename Rpc>
   std::string genGenericArgs(const Rpc& r);
+  template <typename Rpc>
+  std::string genNotifyArgs(const Rpc& r);
 
   template <typename Rpc>
   std::string genParamsFromJsonArray(const Rpc& r);
@@ -58,16 +58,23 @@ void StubGenerator::parseRpc(json::Value& rpc) {
     validateReturns(returnsIter->value);
   }
 
+  Execution execution;
+  auto executionIter = rpc.findMember("execution");
+  if (executionIter != rpc.endMember()) {
+    execution = parseExecution(executionIter->value);
+  }
+
   // 如果没有参数传入那就构造一个Object类型的空Value
   auto paramsValue =
       hasParams ? paramsIter->value : json::Value(json::ValueType::TYPE_OBJECT);
 
   if (hasReturns) {
-    RpcReturn rr(nameIter->value.getString(), paramsValue, returnsIter->value);
+    RpcReturn rr(nameIter->value.getString(), paramsValue, returnsIter->value,
+                 execution);
     serviceInfo_.rpcReturn_.push_back(rr);
   } else {
     // motify没有return
-    RpcNotify rn(nameIter->value.getString(), paramsValue);
+    RpcNotify rn(nameIter->value.getString(), paramsValue, execution);
     serviceInfo_.rpcNotify_.push_back(rn);
   }
 }
@@ -107,5 +114,33 @@ void StubGenerator::validateReturns(json::Value& returns) {
   }
 }
 
+// "inline" | "shared" | {"dedicated": n}, n为正整数
+StubGenerator::Execution StubGenerator::parseExecution(json::Value& execution) {
+  Execution result;
+  if (execution.isString()) {
+    auto policy = execution.getStringView();
+    if (policy == "inline") {
+      result.policy_ = "INLINE";
+    } else if (policy == "shared") {
+      result.policy_ = "SHARED";
+    } else {
+      expect(false, "execution must be 'inline', 'shared' or {'dedicated': n}");
+    }
+    return result;
+  }
+
+  expect(execution.isObject() && execution.getSize() == 1,
+         "execution must be 'inline', 'shared' or {'dedicated': n}");
+  auto threadsIter = execution.findMember("dedicated");
+  expect(threadsIter != execution.endMember(),
+         "execution must be 'inline', 'shared' or {'dedicated': n}");
+  expect(threadsIter->value.getType() == json::ValueType::TYPE_INT32 &&
+             threadsIter->value.getInt32() > 0,
+         "dedicated thread number must be positive integer");
+  result.policy_ = "DEDICATED";
+  result.numThreads_ = threadsIter->value.getInt32();
+  return result;
+}
+
 }  // namespace rpc
 }  // namespace goa
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -21,21 +22,34 @@ class StubGenerator {
   virtual std::string genStubClassName() = 0;
 
  protected:
+  // rpc定义中可选的"execution"字段, 对应ExecutionPolicy
+  // "inline"(缺省), "shared", 或者{"dedicated": 线程数}
+  struct Execution {
+    std::string policy_ = "INLINE";  // ExecutionPolicy的枚举名
+    int32_t numThreads_ = 0;         // 只用于DEDICATED
+  };
+
   struct RpcReturn {
     RpcReturn(const std::string& name, json::Value& params,
-              json::Value& returns)
-        : name_(name), params_(params), returns_(returns) {}
+              json::Value& returns, const Execution& execution)
+        : name_(name),
+          params_(params),
+          returns_(returns),
+          execution_(execution) {}
     std::string name_;
     mutable json::Value params_;
     mutable json::Value returns_;
+    Execution execution_;
   };
 
   struct RpcNotify {
-    RpcNotify(const std::string& name, json::Value& params)
-        : name_(name), params_(params) {}
+    RpcNotify(const std::string& name, json::Value& params,
+              const Execution& execution)
+        : name_(name), params_(params), execution_(execution) {}
 
     std::string name_;
     mutable json::Value params_;
+    Execution execution_;
   };
 
   struct ServiceInfo {
@@ -51,6 +65,7 @@ class StubGenerator {
   void parseRpc(json::Value& rpc);
   void validateParams(json::Value& params);
   void validateReturns(json::Value& returns);
+  Execution parseExecution(json::Value& execution);
 };
 
 // 将str中所有的from字符串替换为to字符串
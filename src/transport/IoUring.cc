@@ -0,0 +1,261 @@
+#include "transport/IoUring.hpp"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit,
+                                    minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg,
+                    unsigned nrArgs) {
+  return static_cast<int>(
+      ::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+template <typename T>
+T* ringField(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+}  // anonymous namespace
+
+IoUring::IoUring(unsigned entries) : sqTailLocal_(0) {
+  memset(&params_, 0, sizeof(params_));
+  fd_ = ioUringSetup(entries, &params_);
+  if (fd_ == -1) {
+    FATAL("io_uring_setup() {}", strerror(errno));
+  }
+
+  sqRingSize_ = params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+  cqRingSize_ =
+      params_.cq_off.cqes + params_.cq_entries * sizeof(struct io_uring_cqe);
+  // 5.4之后的内核sq和cq共用一次mmap
+  bool singleMmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMmap) {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+
+  sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED) {
+    FATAL("io_uring mmap sq ring {}", strerror(errno));
+  }
+  cqRing_ = singleMmap ? sqRing_
+                       : ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, fd_,
+                                IORING_OFF_CQ_RING);
+  if (cqRing_ == MAP_FAILED) {
+    FATAL("io_uring mmap cq ring {}", strerror(errno));
+  }
+  sqesSize_ = params_.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    FATAL("io_uring mmap sqes {}", strerror(errno));
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  sqHead_ = ringField<std::atomic<unsigned>>(sqRing_, params_.sq_off.head);
+  sqTail_ = ringField<std::atomic<unsigned>>(sqRing_, params_.sq_off.tail);
+  sqMask_ = *ringField<unsigned>(sqRing_, params_.sq_off.ring_mask);
+  sqArray_ = ringField<unsigned>(sqRing_, params_.sq_off.array);
+  sqTailLocal_ = sqTail_->load(std::memory_order_relaxed);
+
+  cqHead_ = ringField<std::atomic<unsigned>>(cqRing_, params_.cq_off.head);
+  cqTail_ = ringField<std::atomic<unsigned>>(cqRing_, params_.cq_off.tail);
+  cqMask_ = *ringField<unsigned>(cqRing_, params_.cq_off.ring_mask);
+  cqes_ = ringField<struct io_uring_cqe>(cqRing_, params_.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+  ::munmap(sqes_, sqesSize_);
+  if (cqRing_ != sqRing_) ::munmap(cqRing_, cqRingSize_);
+  ::munmap(sqRing_, sqRingSize_);
+  ::close(fd_);
+}
+
+// provided buffer ring需要5.19, multishot recv需要6.0, 5.19上ioprio不为0的recv以EINVAL失败
+// 因此在socketpair上实际提交一个multishot recv, 确认它收到数据并且仍然有效
+bool IoUring::supported() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = ioUringSetup(4, &params);
+  if (fd == -1) return false;
+  ::close(fd);
+
+  // 在ring之前定义, 保证ring关闭、recv被取消之前缓冲区一直有效
+  char buffer[16];
+  int sockets[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1) {
+    return false;
+  }
+  // 先写入数据, 两种内核上recv都会立即完成
+  char byte = 'P';
+  if (::write(sockets[1], &byte, 1) != 1) {
+    ::close(sockets[0]);
+    ::close(sockets[1]);
+    return false;
+  }
+
+  bool ok = false;
+  size_t size = 4096;
+  void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr != MAP_FAILED) {
+    IoUring ring(4);
+    auto bufRing = static_cast<struct io_uring_buf_ring*>(addr);
+    auto buf = reinterpret_cast<struct io_uring_buf*>(bufRing);
+    buf->addr = reinterpret_cast<uint64_t>(buffer);
+    buf->len = sizeof(buffer);
+    buf->bid = 0;
+    // tail与第一个io_uring_buf的resv字段共用内存, 必须在填写buf之后写入
+    std::atomic_ref<uint16_t>(bufRing->tail).store(1,
+                                                   std::memory_order_release);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(addr);
+    reg.ring_entries = 1;
+    reg.bgid = 0;
+    if (ioUringRegister(ring.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) == 0) {
+      auto sqe = ring.getSqe();
+      sqe->opcode = IORING_OP_RECV;
+      sqe->fd = sockets[0];
+      sqe->ioprio = IORING_RECV_MULTISHOT;
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = 0;
+      ring.submit();
+
+      int n;
+      do {
+        n = ioUringEnter(ring.fd(), 0, 1, IORING_ENTER_GETEVENTS);
+      } while (n == -1 && errno == EINTR);
+      if (n != -1) {
+        ring.forEachCqe([&ok](const struct io_uring_cqe& cqe) {
+          ok = cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER) &&
+               (cqe.flags & IORING_CQE_F_MORE);
+        });
+      }
+    }
+  }
+  ::close(sockets[0]);
+  ::close(sockets[1]);
+  if (addr != MAP_FAILED) ::munmap(addr, size);
+  return ok;
+}
+
+void IoUring::registerEventFd(int eventFd) {
+  if (ioUringRegister(fd_, IORING_REGISTER_EVENTFD, &eventFd, 1) == -1) {
+    FATAL("io_uring register eventfd {}", strerror(errno));
+  }
+}
+
+struct io_uring_sqe* IoUring::getSqe() {
+  if (sqFull()) {
+    submit();
+    // 内核没有取走sqe时下一个槽位仍是未提交的请求, 不能覆盖
+    if (sqFull()) return nullptr;
+  }
+  unsigned index = sqTailLocal_ & sqMask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqArray_[index] = index;
+  sqTailLocal_++;
+  return sqe;
+}
+
+unsigned IoUring::submit() {
+  unsigned tail = sqTail_->load(std::memory_order_relaxed);
+  unsigned toSubmit = sqTailLocal_ - tail;
+  if (toSubmit == 0) return 0;
+  sqTail_->store(sqTailLocal_, std::memory_order_release);
+
+  int n;
+  do {
+    n = ioUringEnter(fd_, toSubmit, 0, 0);
+  } while (n == -1 && errno == EINTR);
+  if (n == -1) {
+    // EAGAIN/EBUSY: 内核暂时无法接收, sqe仍在队列中, 下次submit时再提交
+    // 此时队列可能仍满, getSqe()返回nullptr
+    ERROR("io_uring_enter() {}", strerror(errno));
+    return 0;
+  }
+  return static_cast<unsigned>(n);
+}
+
+IoUringBufRing::IoUringBufRing(IoUring& ring, uint16_t groupId,
+                               unsigned count, size_t bufferSize)
+    : ring_(ring),
+      groupId_(groupId),
+      count_(count),
+      bufferSize_(bufferSize),
+      buffers_(count * bufferSize),
+      tail_(0) {
+  // count必须是2的幂, ring需要页对齐
+  bufRingSize_ = count_ * sizeof(struct io_uring_buf);
+  void* addr = ::mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    FATAL("io_uring mmap buf ring {}", strerror(errno));
+  }
+  bufRing_ = static_cast<struct io_uring_buf_ring*>(addr);
+
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+  reg.ring_entries = count_;
+  reg.bgid = groupId_;
+  if (ioUringRegister(ring_.fd(), IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+    FATAL("io_uring register buf ring {}", strerror(errno));
+  }
+
+  for (unsigned i = 0; i < count_; i++) {
+    recycle(static_cast<uint16_t>(i));
+  }
+}
+
+IoUringBufRing::~IoUringBufRing() {
+  struct io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.bgid = groupId_;
+  ioUringRegister(ring_.fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+  ::munmap(bufRing_, bufRingSize_);
+}
+
+void IoUringBufRing::recycle(uint16_t bufferId) {
+  // 不用bufRing_->bufs: uapi头文件的flexible array在C++中偏移不为0
+  struct io_uring_buf* buf =
+      reinterpret_cast<struct io_uring_buf*>(bufRing_) + (tail_ & (count_ - 1));
+  buf->addr = reinterpret_cast<uint64_t>(buffer(bufferId));
+  buf->len = static_cast<uint32_t>(bufferSize_);
+  buf->bid = bufferId;
+  tail_++;
+  // tail与第一个io_uring_buf的resv字段共用内存
+  std::atomic_ref<uint16_t>(bufRing_->tail).store(tail_,
+                                                   std::memory_order_release);
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 直接基于io_uring系统调用的最小封装, 不依赖liburing
+只在一个线程中使用: getSqe()填写请求, submit()一次性提交,
+forEachCqe()处理所有已完成的请求
+*/
+class IoUring : noncopyable {
+ public:
+  explicit IoUring(unsigned entries);
+  ~IoUring();
+
+  // 内核是否支持provided buffer ring和multishot recv, 不支持时退回epoll
+  static bool supported();
+
+  int fd() const { return fd_; }
+
+  // 完成事件通知到eventfd, 以便在EventLoop中等待
+  void registerEventFd(int eventFd);
+
+  // 返回清零的sqe, 提交队列已满时先提交
+  // 内核暂时无法接收(EAGAIN/EBUSY)而队列仍满时返回nullptr, 由调用者稍后重试
+  struct io_uring_sqe* getSqe();
+  // 提交所有已填写的sqe, 返回提交的数量
+  unsigned submit();
+
+  template <typename Func>
+  void forEachCqe(Func&& func) {
+    unsigned head = cqHead_->load(std::memory_order_relaxed);
+    while (head != cqTail_->load(std::memory_order_acquire)) {
+      const struct io_uring_cqe cqe = cqes_[head & cqMask_];
+      // 先归还cqe槽位, func中可能继续提交请求
+      cqHead_->store(++head, std::memory_order_release);
+      func(cqe);
+    }
+  }
+
+ private:
+  bool sqFull() const {
+    return sqTailLocal_ - sqHead_->load(std::memory_order_acquire) >=
+           params_.sq_entries;
+  }
+
+  int fd_;
+  struct io_uring_params params_;
+  void* sqRing_;
+  size_t sqRingSize_;
+  void* cqRing_;
+  size_t cqRingSize_;
+  struct io_uring_sqe* sqes_;
+  size_t sqesSize_;
+
+  std::atomic<unsigned>* sqHead_;
+  std::atomic<unsigned>* sqTail_;
+  unsigned sqMask_;
+  unsigned* sqArray_;
+  unsigned sqTailLocal_;  // 已填写但尚未提交的sqe之后的位置
+
+  std::atomic<unsigned>* cqHead_;
+  std::atomic<unsigned>* cqTail_;
+  unsigned cqMask_;
+  struct io_uring_cqe* cqes_;
+};
+
+/* provided buffer ring: 一组预先交给内核的定长接收缓冲区
+recv时不指定缓冲区, 由内核在数据到达时挑选一个, 只有真正有数据的连接才占用缓冲区,
+cqe中带回缓冲区编号, 数据取走后归还
+*/
+class IoUringBufRing : noncopyable {
+ public:
+  IoUringBufRing(IoUring& ring, uint16_t groupId, unsigned count,
+                 size_t bufferSize);
+  ~IoUringBufRing();
+
+  uint16_t groupId() const { return groupId_; }
+  const char* buffer(uint16_t bufferId) const {
+    return buffers_.data() + bufferId * bufferSize_;
+  }
+  // 归还缓冲区, 内核可以再次使用
+  void recycle(uint16_t bufferId);
+
+ private:
+  IoUring& ring_;
+  uint16_t groupId_;
+  unsigned count_;
+  size_t bufferSize_;
+  struct io_uring_buf_ring* bufRing_;
+  size_t bufRingSize_;
+  std::vector<char> buffers_;
+  uint16_t tail_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,88 @@
+#include "transport/Listener.hpp"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+Listener::Listener(EventLoop* loop, int listenFd, const std::string& name)
+    : loop_(loop),
+      name_(name),
+      acceptFd_(listenFd),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+      acceptChannel_(loop, acceptFd_),
+      started_(false) {
+  if (idleFd_ == -1) FATAL("{} open(/dev/null) {}", name_, strerror(errno));
+  INFO("create {}", name_);
+}
+
+Listener::~Listener() {
+  if (started_) acceptChannel_.disableAll();
+  ::close(acceptFd_);
+  if (idleFd_ != -1) ::close(idleFd_);
+}
+
+void Listener::start() {
+  if (started_) return;
+  started_ = true;
+  loop_->runInLoop([this]() {
+    if (::listen(acceptFd_, SOMAXCONN) == -1) {
+      FATAL("{} listen() {}", name_, strerror(errno));
+    }
+    acceptChannel_.setReadCallback([this]() { handleAccept(); });
+    acceptChannel_.enableRead();
+    INFO("{} start()", name_);
+  });
+}
+
+void Listener::handleAccept() {
+  loop_->assertInLoopThread();
+  while (true) {
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    int connfd = ::accept4(acceptFd_, reinterpret_cast<struct sockaddr*>(&addr),
+                           &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (connfd != -1) {
+      InetAddress peer;
+      if (addr.ss_family == AF_INET) {
+        peer.setAddress(*reinterpret_cast<struct sockaddr_in*>(&addr));
+      }
+      newConnectionCallback_(connfd, peer);
+      continue;
+    }
+    switch (errno) {
+      case EAGAIN:
+      case ECONNABORTED:
+      case EINTR:
+        return;
+      case EMFILE:
+      case ENFILE:
+        // fd耗尽, 连接留在队列中会使监听socket一直可读
+        // 借用预留的fd取出该连接并关闭, 再重新预留
+        ERROR("{} accept4() {}, drop connection", name_, strerror(errno));
+        if (idleFd_ != -1) ::close(idleFd_);
+        connfd = ::accept(acceptFd_, nullptr, nullptr);
+        if (connfd != -1) ::close(connfd);
+        // 其他线程可能同时占用了释放的fd, 重新预留失败时下次再试
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (connfd == -1) return;
+        continue;
+      default:
+        ERROR("{} accept4() {}", name_, strerror(errno));
+        return;
+    }
+  }
+}
+
+}  // namespace rpc
+
+}  // namespace goa
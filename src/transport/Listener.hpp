@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cassert>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "goa-ev/src/Channel.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 监听socket及其accept循环, 由ReusePortServer、UnixServer、ShmServer和UringServer共用
+各server只负责创建已bind的监听socket、处理accept得到的连接, 所有操作都在loop线程中进行
+*/
+class Listener : noncopyable {
+ public:
+  // connfd为非阻塞的已连接socket, Unix domain socket没有ip:port, peer为空的InetAddress
+  using NewConnectionCallback =
+      std::function<void(int connfd, const InetAddress& peer)>;
+
+  // listenFd为已bind、尚未listen的非阻塞socket, 由Listener负责关闭; name只用于日志
+  Listener(EventLoop* loop, int listenFd, const std::string& name);
+  ~Listener();
+
+  // 在loop线程中开始listen, 可以在其他线程调用, 重复调用无效
+  void start();
+
+  void setNewConnectionCallback(const NewConnectionCallback& callback) {
+    newConnectionCallback_ = callback;
+  }
+
+ private:
+  void handleAccept();
+
+  EventLoop* loop_;
+  std::string name_;
+  int acceptFd_;
+  // 预留的fd, fd耗尽时关闭它以accept并立即关闭新连接, 否则监听socket一直可读, loop空转
+  int idleFd_;
+  ev::Channel acceptChannel_;
+  bool started_;
+  NewConnectionCallback newConnectionCallback_;
+};
+
+// server已建立的连接, 每个连接附带server自己的状态, 在loop线程中访问
+template <typename Value>
+class ConnectionMap : noncopyable {
+ public:
+  void add(const TcpConnectionPtr& conn, Value value) {
+    connections_.emplace(conn, std::move(value));
+  }
+
+  // conn必须存在, 返回它附带的状态
+  Value remove(const TcpConnectionPtr& conn) {
+    auto it = connections_.find(conn);
+    assert(it != connections_.end());
+    Value value = std::move(it->second);
+    connections_.erase(it);
+    return value;
+  }
+
+  // server析构时调用, 先以每个连接的状态调用func, 再forceClose该连接
+  // forceClose会通过server的closeConnection修改连接集合, 因此遍历副本
+  template <typename Func>
+  void forceCloseAll(Func&& func) {
+    auto connections = connections_;
+    for (auto& [conn, value] : connections) {
+      func(value);
+      conn->forceClose();
+    }
+  }
+  void forceCloseAll() {
+    forceCloseAll([](Value&) {});
+  }
+
+ private:
+  std::map<TcpConnectionPtr, Value> connections_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,38 @@
+#include "transport/ReusePortServer.hpp"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+int createReusePortListenSocket(const InetAddress& local) {
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    FATAL("ReusePortServer socket() {}", strerror(errno));
+  }
+
+  int on = 1;
+  if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == -1 ||
+      ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+    FATAL("ReusePortServer setsockopt() {}", strerror(errno));
+  }
+  if (::bind(fd, local.getSockaddr(), local.getSocklen()) == -1) {
+    FATAL("ReusePortServer bind() {} {}", local.toIpPort(), strerror(errno));
+  }
+  return fd;
+}
+
+ReusePortServer::ReusePortServer(EventLoop* loop, const InetAddress& local)
+    : StreamServer(loop, createReusePortListenSocket(local),
+                   "ReusePortServer " + local.toIpPort(), local, true) {}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "transport/StreamServer.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 创建设置了SO_REUSEPORT的非阻塞TCP socket并bind到local, 尚未listen, 失败时FATAL
+int createReusePortListenSocket(const InetAddress& local);
+
+// 监听设置了SO_REUSEPORT的TCP端口, 多个ReusePortServer可以绑定同一地址,
+// 由内核按连接的四元组哈希分配, 各自独立accept. 所有连接都在loop线程中处理
+class ReusePortServer : public StreamServer {
+ public:
+  ReusePortServer(EventLoop* loop, const InetAddress& local);
+};
+
+}  // namespace rpc
+
+}  // namespace goa
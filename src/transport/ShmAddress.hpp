@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+namespace goa {
+
+namespace rpc {
+
+// 共享内存传输的地址
+// path为控制用的Unix domain socket, 客户端通过它把共享内存和eventfd交给服务端,
+// 此后request和response都经过共享内存中的环形缓冲区, 控制socket只用于感知连接断开
+class ShmAddress {
+ public:
+  explicit ShmAddress(std::string path) : path_(std::move(path)) {}
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,323 @@
+#include "transport/ShmChannel.hpp"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+bool createShmHandles(ShmHandles* handles) {
+  handles->memfd = ::memfd_create("goa-rpc-shm", MFD_CLOEXEC);
+  handles->clientEventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  handles->serverEventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (handles->memfd == -1 || handles->clientEventFd == -1 ||
+      handles->serverEventFd == -1) {
+    ERROR("createShmHandles() {}", strerror(errno));
+    closeShmHandles(*handles);
+    return false;
+  }
+
+  if (::ftruncate(handles->memfd, sizeof(ShmRegion)) == -1) {
+    ERROR("createShmHandles() ftruncate {}", strerror(errno));
+    closeShmHandles(*handles);
+    return false;
+  }
+
+  void* addr = ::mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, handles->memfd, 0);
+  if (addr == MAP_FAILED) {
+    ERROR("createShmHandles() mmap {}", strerror(errno));
+    closeShmHandles(*handles);
+    return false;
+  }
+
+  // ftruncate得到的内存全为0, 只需构造atomic并写入版本信息
+  auto region = static_cast<ShmRegion*>(addr);
+  new (&region->requests.head) std::atomic<uint64_t>(0);
+  new (&region->requests.tail) std::atomic<uint64_t>(0);
+  new (&region->responses.head) std::atomic<uint64_t>(0);
+  new (&region->responses.tail) std::atomic<uint64_t>(0);
+  // 初始时双方都视为sleeping, 第一次写入总会唤醒对端
+  new (&region->clientSleeping) std::atomic<uint32_t>(1);
+  new (&region->serverSleeping) std::atomic<uint32_t>(1);
+  region->version = kShmVersion;
+  region->magic = kShmMagic;
+  ::munmap(addr, sizeof(ShmRegion));
+  return true;
+}
+
+bool sendShmHandles(int sockfd, const ShmHandles& handles) {
+  int fds[3] = {handles.memfd, handles.clientEventFd, handles.serverEventFd};
+  char cmsgBuf[CMSG_SPACE(sizeof(fds))];
+  memset(cmsgBuf, 0, sizeof(cmsgBuf));
+
+  char byte = 'S';
+  struct iovec iov = {&byte, 1};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsgBuf;
+  msg.msg_controllen = sizeof(cmsgBuf);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+  if (::sendmsg(sockfd, &msg, MSG_NOSIGNAL) != 1) {
+    ERROR("sendShmHandles() {}", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool recvShmHandles(int sockfd, ShmHandles* handles) {
+  int fds[3];
+  char cmsgBuf[CMSG_SPACE(sizeof(fds))];
+  char byte;
+  struct iovec iov = {&byte, 1};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cmsgBuf;
+  msg.msg_controllen = sizeof(cmsgBuf);
+
+  ssize_t n = ::recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+  if (n == -1) {
+    // 非阻塞socket上handles尚未到达, 由调用者等待可读后重试
+    int savedErrno = errno;
+    if (savedErrno != EAGAIN) {
+      ERROR("recvShmHandles() {}", strerror(savedErrno));
+    }
+    errno = savedErrno;
+    return false;
+  }
+  if (n == 0) {
+    ERROR("recvShmHandles() peer closed");
+    errno = ECONNRESET;
+    return false;
+  }
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+      cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+    ERROR("recvShmHandles() bad control message");
+    errno = EPROTO;
+    return false;
+  }
+  memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  handles->memfd = fds[0];
+  handles->clientEventFd = fds[1];
+  handles->serverEventFd = fds[2];
+  return true;
+}
+
+void closeShmHandles(const ShmHandles& handles) {
+  if (handles.memfd != -1) ::close(handles.memfd);
+  if (handles.clientEventFd != -1) ::close(handles.clientEventFd);
+  if (handles.serverEventFd != -1) ::close(handles.serverEventFd);
+}
+
+ShmChannel::ShmChannel(EventLoop* loop, const ShmHandles& handles,
+                       bool isServer)
+    : loop_(loop),
+      handles_(handles),
+      isServer_(isServer),
+      region_(nullptr),
+      in_(nullptr),
+      out_(nullptr),
+      localSleeping_(nullptr),
+      peerSleeping_(nullptr),
+      localEventFd_(isServer ? handles.serverEventFd : handles.clientEventFd),
+      peerEventFd_(isServer ? handles.clientEventFd : handles.serverEventFd),
+      channel_(loop, localEventFd_),
+      started_(false),
+      reading_(true) {}
+
+ShmChannel::~ShmChannel() {
+  assert(!started_);
+  if (region_ != nullptr) ::munmap(region_, sizeof(ShmRegion));
+  closeShmHandles(handles_);
+}
+
+bool ShmChannel::map() {
+  struct stat st;
+  if (::fstat(handles_.memfd, &st) == -1 ||
+      static_cast<size_t>(st.st_size) != sizeof(ShmRegion)) {
+    ERROR("ShmChannel::map() bad shared memory size");
+    return false;
+  }
+
+  void* addr = ::mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, handles_.memfd, 0);
+  if (addr == MAP_FAILED) {
+    ERROR("ShmChannel::map() {}", strerror(errno));
+    return false;
+  }
+  region_ = static_cast<ShmRegion*>(addr);
+  if (region_->magic != kShmMagic || region_->version != kShmVersion) {
+    ERROR("ShmChannel::map() bad shared memory version");
+    return false;
+  }
+
+  in_ = isServer_ ? &region_->requests : &region_->responses;
+  out_ = isServer_ ? &region_->responses : &region_->requests;
+  localSleeping_ =
+      isServer_ ? &region_->serverSleeping : &region_->clientSleeping;
+  peerSleeping_ =
+      isServer_ ? &region_->clientSleeping : &region_->serverSleeping;
+  return true;
+}
+
+void ShmChannel::start() {
+  loop_->assertInLoopThread();
+  assert(region_ != nullptr);
+  started_ = true;
+  channel_.setReadCallback([this]() { handleRead(); });
+  channel_.enableRead();
+  pump();  // 对端可能在我们注册eventfd之前就已经写入了数据
+}
+
+void ShmChannel::close() {
+  loop_->assertInLoopThread();
+  if (!started_) return;
+  started_ = false;
+  channel_.disableAll();
+  messageCallback_ = nullptr;
+  closeCallback_ = nullptr;
+}
+
+void ShmChannel::send(Buffer& buf) {
+  if (loop_->isInLoopThread()) {
+    sendInLoop(std::string_view(buf.peek(), buf.readableBytes()));
+    buf.retrieveAll();
+  } else {
+    loop_->queueInLoop(
+        [self = shared_from_this(), data = buf.retrieveAllAsString()]() {
+          self->sendInLoop(data);
+        });
+  }
+}
+
+void ShmChannel::stopRead() {
+  loop_->runInLoop([self = shared_from_this()]() { self->reading_ = false; });
+}
+
+void ShmChannel::startRead() {
+  loop_->runInLoop([self = shared_from_this()]() {
+    if (self->reading_) return;
+    self->reading_ = true;
+    if (self->started_) self->pump();  // 停止读期间环中可能已有数据
+  });
+}
+
+void ShmChannel::handleRead() {
+  uint64_t count;
+  // 清空eventfd计数, EAGAIN表示已被清空
+  if (::read(localEventFd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    ERROR("ShmChannel::handleRead() read eventfd {}", strerror(errno));
+  }
+  pump();
+}
+
+void ShmChannel::sendInLoop(std::string_view data) {
+  loop_->assertInLoopThread();
+  if (!started_) return;
+
+  size_t n = 0;
+  // 已有暂存数据时必须排在其后, 保证字节流顺序
+  if (pendingOutput_.readableBytes() == 0) {
+    if (!out_->write(data.data(), data.size(), &n)) {
+      handleRingError();
+      return;
+    }
+    if (n > 0) notifyPeer();
+  }
+  if (n < data.size()) {
+    pendingOutput_.append(data.data() + n, data.size() - n);
+  }
+}
+
+// 读出所有到达的数据, 写出暂存的数据, 直到无事可做再准备阻塞
+// 不在此自旋等待对端: pump运行在IO线程中, 自旋会推迟同一loop上其他连接的事件
+void ShmChannel::pump() {
+  while (started_) {
+    bool progress = false;
+
+    size_t n = 0;
+    if (reading_ && !in_->read(input_, &n)) {
+      handleRingError();
+      return;
+    }
+    if (n > 0) {
+      progress = true;
+      notifyPeer();  // 腾出了空间, 对端可能在等待写入
+      if (messageCallback_) messageCallback_(input_);
+      if (!started_) return;  // messageCallback中可能关闭了连接
+    }
+
+    if (pendingOutput_.readableBytes() > 0) {
+      size_t written;
+      if (!out_->write(pendingOutput_.peek(), pendingOutput_.readableBytes(),
+                       &written)) {
+        handleRingError();
+        return;
+      }
+      if (written > 0) {
+        pendingOutput_.retrieve(written);
+        progress = true;
+        notifyPeer();
+      }
+    }
+
+    if (progress) continue;
+
+    // 先声明将要阻塞, 再复查一次, 避免对端在此期间写入却没有唤醒我们
+    localSleeping_->store(1, std::memory_order_seq_cst);
+    size_t readable;
+    size_t writable;
+    if (!in_->readableBytes(&readable) || !out_->writableBytes(&writable)) {
+      handleRingError();
+      return;
+    }
+    bool hasWork = (reading_ && readable > 0) ||
+                   (pendingOutput_.readableBytes() > 0 && writable > 0);
+    if (!hasWork) return;
+    localSleeping_->store(0, std::memory_order_seq_cst);
+  }
+}
+
+void ShmChannel::notifyPeer() {
+  if (peerSleeping_->exchange(0, std::memory_order_seq_cst) != 0) {
+    uint64_t one = 1;
+    // EAGAIN表示计数已满, 对端已被通知过
+    if (::write(peerEventFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      ERROR("ShmChannel::notifyPeer() write eventfd {}", strerror(errno));
+    }
+  }
+}
+
+void ShmChannel::handleRingError() {
+  ERROR("ShmChannel ring head/tail out of range, close channel");
+  auto callback = std::move(closeCallback_);
+  close();
+  if (callback) callback();
+}
+
+}  // namespace rpc
+
+}  // namespace goa
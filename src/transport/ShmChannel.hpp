@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string_view>
+
+#include "goa-ev/src/Channel.hpp"
+#include "transport/ShmRing.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 建立共享内存传输所需的文件描述符, 由客户端创建, 通过控制socket交给服务端
+struct ShmHandles {
+  int memfd = -1;
+  int clientEventFd = -1;  // 客户端等待的eventfd
+  int serverEventFd = -1;  // 服务端等待的eventfd
+};
+
+// 客户端: 创建并初始化共享内存和eventfd, 失败返回false
+bool createShmHandles(ShmHandles* handles);
+// 通过Unix domain socket以SCM_RIGHTS发送/接收handles
+// 非阻塞socket上handles尚未到达时recvShmHandles返回false且errno为EAGAIN
+bool sendShmHandles(int sockfd, const ShmHandles& handles);
+bool recvShmHandles(int sockfd, ShmHandles* handles);
+void closeShmHandles(const ShmHandles& handles);
+
+/* 共享内存连接的一端, 管理一对环形缓冲区和eventfd唤醒
+收到的数据追加到input buffer后交给messageCallback, 与TcpConnection的onMessage语义相同
+唤醒协议: 一端准备阻塞前先置sleeping标志再复查环, 另一端写入或读出数据后
+若发现对端sleeping则清除标志并写eventfd, 两处都用seq_cst保证不会丢失唤醒
+*/
+class ShmChannel : noncopyable,
+                   public std::enable_shared_from_this<ShmChannel> {
+ public:
+  using MessageCallback = std::function<void(Buffer&)>;
+  using CloseCallback = std::function<void()>;
+
+  // 接管handles中的文件描述符
+  ShmChannel(EventLoop* loop, const ShmHandles& handles, bool isServer);
+  ~ShmChannel();
+
+  // 映射共享内存, 服务端会校验其大小和版本, 失败返回false
+  bool map();
+
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+  // 发现对端写坏了环的head/tail时, 关闭channel后调用, 由上层断开控制连接
+  void setCloseCallback(const CloseCallback& callback) {
+    closeCallback_ = callback;
+  }
+
+  // 在loop线程中开始监听eventfd
+  void start();
+  // 关闭后不再收发数据, 在loop线程中调用
+  void close();
+
+  // 可以在任意线程中调用, 取走buf中的全部数据
+  void send(Buffer& buf);
+
+  void stopRead();
+  void startRead();
+
+ private:
+  void handleRead();
+  void sendInLoop(std::string_view data);
+  void pump();
+  void notifyPeer();
+  void handleRingError();
+
+  EventLoop* loop_;
+  ShmHandles handles_;
+  const bool isServer_;
+  ShmRegion* region_;
+  ShmRing* in_;
+  ShmRing* out_;
+  std::atomic<uint32_t>* localSleeping_;
+  std::atomic<uint32_t>* peerSleeping_;
+  int localEventFd_;
+  int peerEventFd_;
+  ev::Channel channel_;
+  bool started_;
+  bool reading_;
+  Buffer input_;
+  Buffer pendingOutput_;  // 环已满时暂存, 对端读出数据后继续写
+  MessageCallback messageCallback_;
+  CloseCallback closeCallback_;
+};
+
+using ShmChannelPtr = std::shared_ptr<ShmChannel>;
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,132 @@
+#include "transport/ShmClient.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+#include "transport/UnixSocket.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+const std::chrono::milliseconds kInitRetryDelay = 500ms;
+const std::chrono::milliseconds kMaxRetryDelay = 30s;
+
+}  // anonymous namespace
+
+ShmClient::ShmClient(EventLoop* loop, const ShmAddress& peer)
+    : loop_(loop),
+      peer_(peer),
+      started_(false),
+      retryDelay_(kInitRetryDelay),
+      connectionCallback_(ev::defaultConnectionCallback),
+      messageCallback_(ev::defaultMessageCallback) {}
+
+ShmClient::~ShmClient() {
+  if (channel_) channel_->close();
+  if (connection_ && !connection_->disconnected()) {
+    connection_->forceClose();
+  }
+}
+
+void ShmClient::start() {
+  if (started_) return;
+  started_ = true;
+  loop_->runInLoop([this]() { connect(); });
+}
+
+void ShmClient::send(Buffer& buf) {
+  ShmChannelPtr channel;
+  {
+    std::lock_guard lock(mutex_);
+    channel = channel_;
+  }
+  if (channel) {
+    channel->send(buf);
+  } else {
+    buf.retrieveAll();
+  }
+}
+
+void ShmClient::connect() {
+  loop_->assertInLoopThread();
+
+  int fd = connectUnixSocket(peer_.path());
+  if (fd == -1) {
+    WARN("ShmClient::connect() {} {}", peer_.path(), strerror(errno));
+    retry();
+    return;
+  }
+
+  retryDelay_ = kInitRetryDelay;
+  newConnection(fd);
+}
+
+void ShmClient::retry() {
+  INFO("ShmClient::retry() reconnect {} after {}ms", peer_.path(),
+       retryDelay_.count());
+  loop_->runAfter(retryDelay_, [this]() { connect(); });
+  retryDelay_ = std::min(retryDelay_ * 2, kMaxRetryDelay);
+}
+
+void ShmClient::newConnection(int connfd) {
+  ShmHandles handles;
+  if (!createShmHandles(&handles)) {
+    FATAL("ShmClient::newConnection() create shared memory failed");
+  }
+  if (!sendShmHandles(connfd, handles)) {
+    closeShmHandles(handles);
+    ::close(connfd);
+    retry();
+    return;
+  }
+
+  // 服务端持有fd的副本, 本端的ShmChannel接管本端的fd
+  auto channel = std::make_shared<ShmChannel>(loop_, handles, false);
+  if (!channel->map()) {
+    FATAL("ShmClient::newConnection() map shared memory failed");
+  }
+
+  auto conn =
+      std::make_shared<TcpConnection>(loop_, connfd, InetAddress(), InetAddress());
+  conn->setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer& buf) { buf.retrieveAll(); });
+  conn->setCloseCallback([this](const TcpConnectionPtr& c) { closeConnection(c); });
+  channel->setMessageCallback(
+      [conn, this](Buffer& buf) { messageCallback_(conn, buf); });
+  channel->setCloseCallback([weak = std::weak_ptr<TcpConnection>(conn)]() {
+    if (auto c = weak.lock()) c->forceClose();
+  });
+  connection_ = conn;
+  {
+    std::lock_guard lock(mutex_);
+    channel_ = channel;
+  }
+  conn->connectEstablished();
+  channel->start();
+  connectionCallback_(conn);
+}
+
+void ShmClient::closeConnection(const TcpConnectionPtr& conn) {
+  loop_->assertInLoopThread();
+  assert(connection_ == conn);
+  ShmChannelPtr channel;
+  {
+    std::lock_guard lock(mutex_);
+    channel.swap(channel_);
+  }
+  channel->close();  // 清除messageCallback, 打破channel与conn之间的引用环
+  connectionCallback_(conn);
+  connection_.reset();
+}
+
+}  // namespace rpc
+
+}  // namespace goa
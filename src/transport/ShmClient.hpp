@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+
+#include "transport/ShmAddress.hpp"
+#include "transport/ShmChannel.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 共享内存传输的客户端, 接口与TcpClient一致
+// 连接控制socket后创建共享内存和eventfd并交给服务端, 服务端尚未启动时按指数退避重试
+class ShmClient : noncopyable {
+ public:
+  ShmClient(EventLoop* loop, const ShmAddress& peer);
+  ~ShmClient();
+
+  void start();
+
+  void setConnectionCallback(const ConnectionCallback& callback) {
+    connectionCallback_ = callback;
+  }
+  // 从ShmChannel收到数据时调用, conn为控制连接
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+
+  // 可以在任意线程中调用, 取走buf中的全部数据. 未连接时丢弃
+  void send(Buffer& buf);
+
+ private:
+  void connect();
+  void retry();
+  void newConnection(int connfd);
+  void closeConnection(const TcpConnectionPtr& conn);
+
+  EventLoop* loop_;
+  ShmAddress peer_;
+  bool started_;
+  std::chrono::milliseconds retryDelay_;
+  TcpConnectionPtr connection_;
+  // 只在loop线程中修改, send可能在其他线程中读取, 由mutex_保护
+  std::mutex mutex_;
+  ShmChannelPtr channel_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
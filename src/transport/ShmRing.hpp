@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+constexpr size_t kShmRingCapacity = 1 << 20;  // 必须是2的幂
+constexpr uint32_t kShmMagic = 0x676f6173;    // "goas"
+constexpr uint32_t kShmVersion = 1;
+
+static_assert((kShmRingCapacity & (kShmRingCapacity - 1)) == 0,
+              "ring capacity must be power of 2");
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "atomics in shared memory must be lock free");
+
+/* 单生产者单消费者的字节环形缓冲区, 位于进程间共享的内存中
+环中传输的是与socket上完全相同的字节流(header + body), 因此两端仍然用FrameDecoder拆包,
+写入可以只写一部分, 剩余部分由写端暂存并在对端腾出空间后继续写
+head和tail单调递增, 取模后得到下标, 分别由生产者和消费者独占修改
+对端有缺陷或恶意时可能写坏head和tail, 因此读写前都会检查, 不合法时由ShmChannel关闭连接
+*/
+struct ShmRing {
+  alignas(64) std::atomic<uint64_t> head;  // 写位置
+  alignas(64) std::atomic<uint64_t> tail;  // 读位置
+  alignas(64) char data[kShmRingCapacity];
+
+  // head和tail位于共享内存中, 对端可以写入任意值, 每次使用前都要检查
+  // 合法时tail <= head且head - tail不超过容量, 否则应断开对端
+  static bool valid(uint64_t h, uint64_t t) {
+    return t <= h && h - t <= kShmRingCapacity;
+  }
+
+  // 消费者调用, head/tail不合法时返回false
+  bool readableBytes(size_t* n) const {
+    uint64_t h = head.load(std::memory_order_acquire);
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    if (!valid(h, t)) return false;
+    *n = static_cast<size_t>(h - t);
+    return true;
+  }
+
+  // 生产者调用, head/tail不合法时返回false
+  bool writableBytes(size_t* n) const {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    if (!valid(h, t)) return false;
+    *n = kShmRingCapacity - static_cast<size_t>(h - t);
+    return true;
+  }
+
+  // 生产者调用, written为实际写入的字节数, head/tail不合法时返回false
+  bool write(const char* src, size_t len, size_t* written) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    if (!valid(h, t)) return false;
+    // 只使用检查过的h和t, 对端之后再修改也不会越界
+    size_t n = std::min(len, kShmRingCapacity - static_cast<size_t>(h - t));
+    *written = n;
+    if (n == 0) return true;
+
+    size_t pos = static_cast<size_t>(h) & (kShmRingCapacity - 1);
+    size_t first = std::min(n, kShmRingCapacity - pos);
+    memcpy(data + pos, src, first);
+    memcpy(data, src + first, n - first);
+    head.store(h + n, std::memory_order_release);
+    return true;
+  }
+
+  // 消费者调用, 把所有可读字节追加到buf, n为字节数, head/tail不合法时返回false
+  bool read(Buffer& buf, size_t* n) {
+    uint64_t h = head.load(std::memory_order_acquire);
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    if (!valid(h, t)) return false;
+    *n = static_cast<size_t>(h - t);
+    if (*n == 0) return true;
+
+    size_t pos = static_cast<size_t>(t) & (kShmRingCapacity - 1);
+    size_t first = std::min(*n, kShmRingCapacity - pos);
+    buf.ensureWritableBytes(*n);
+    memcpy(buf.beginWrite(), data + pos, first);
+    memcpy(buf.beginWrite() + first, data, *n - first);
+    buf.hasWritten(*n);
+    tail.store(t + *n, std::memory_order_release);
+    return true;
+  }
+};
+
+// 每个客户端一块共享内存, 由客户端创建并初始化
+struct ShmRegion {
+  uint32_t magic;
+  uint32_t version;
+  ShmRing requests;   // 客户端 -> 服务端
+  ShmRing responses;  // 服务端 -> 客户端
+
+  // 为1表示该端即将阻塞在eventfd上, 对端写入或读出数据后需要写eventfd唤醒它
+  alignas(64) std::atomic<uint32_t> clientSleeping;
+  alignas(64) std::atomic<uint32_t> serverSleeping;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,121 @@
+#include "transport/ShmServer.hpp"
+
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+#include "transport/UnixSocket.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 服务端accept后等待客户端发来handles的最长时间
+const std::chrono::milliseconds kHandshakeTimeout = 100ms;
+
+}  // anonymous namespace
+
+ShmServer::ShmServer(EventLoop* loop, const ShmAddress& local)
+    : loop_(loop),
+      local_(local),
+      listener_(loop, createUnixListenSocket(local.path()),
+                "ShmServer " + local.path()),
+      messageCallback_(ev::defaultMessageCallback) {
+  listener_.setNewConnectionCallback(
+      [this](int connfd, const InetAddress&) { newHandshake(connfd); });
+}
+
+ShmServer::~ShmServer() {
+  for (auto& [connfd, handshake] : handshakes_) {
+    loop_->cancelTimer(handshake->timer);
+    handshake->channel.disableAll();
+    ::close(connfd);
+  }
+  connections_.forceCloseAll(
+      [](const ShmChannelPtr& channel) { channel->close(); });
+  ::unlink(local_.path().c_str());
+}
+
+void ShmServer::start() { listener_.start(); }
+
+void ShmServer::newHandshake(int connfd) {
+  auto handshake = std::make_shared<Handshake>(loop_, connfd);
+  handshakes_.emplace(connfd, handshake);
+  handshake->channel.setReadCallback(
+      [this, connfd]() { handleHandshake(connfd); });
+  handshake->channel.enableRead();
+  handshake->timer = loop_->runAfter(kHandshakeTimeout, [this, connfd]() {
+    ERROR("ShmServer handshake timeout");
+    handshakes_.at(connfd)->timer = nullptr;  // 已经触发, 不需要再取消
+    removeHandshake(connfd);
+    ::close(connfd);
+  });
+  // 客户端在connect之后立即发送, 通常accept时已经到达
+  handleHandshake(connfd);
+}
+
+void ShmServer::handleHandshake(int connfd) {
+  loop_->assertInLoopThread();
+  ShmHandles handles;
+  if (!recvShmHandles(connfd, &handles)) {
+    if (errno == EAGAIN) return;
+    removeHandshake(connfd);
+    ::close(connfd);
+    return;
+  }
+  removeHandshake(connfd);
+  newConnection(connfd, handles);
+}
+
+void ShmServer::removeHandshake(int connfd) {
+  auto it = handshakes_.find(connfd);
+  assert(it != handshakes_.end());
+  auto handshake = it->second;
+  handshakes_.erase(it);
+  if (handshake->timer != nullptr) loop_->cancelTimer(handshake->timer);
+  handshake->channel.disableAll();
+  // 可能正处于该channel的回调中, 推迟到本轮事件处理之后析构
+  loop_->queueInLoop([handshake]() {});
+}
+
+void ShmServer::newConnection(int connfd, const ShmHandles& handles) {
+  auto channel = std::make_shared<ShmChannel>(loop_, handles, true);
+  if (!channel->map()) {
+    ::close(connfd);
+    return;
+  }
+
+  // 控制连接上不应有数据, 只用于感知对端断开
+  auto conn =
+      std::make_shared<TcpConnection>(loop_, connfd, InetAddress(), InetAddress());
+  connections_.add(conn, channel);
+  conn->setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer& buf) { buf.retrieveAll(); });
+  conn->setCloseCallback([this](const TcpConnectionPtr& c) { closeConnection(c); });
+  conn->connectEstablished();
+
+  // 先通知上层建立连接上下文, 再开始接收request
+  channel->setMessageCallback(
+      [conn, this](Buffer& buf) { messageCallback_(conn, buf); });
+  channel->setCloseCallback([weak = std::weak_ptr<TcpConnection>(conn)]() {
+    if (auto c = weak.lock()) c->forceClose();
+  });
+  connectionCallback_(conn, channel);
+  channel->start();
+}
+
+void ShmServer::closeConnection(const TcpConnectionPtr& conn) {
+  loop_->assertInLoopThread();
+  auto channel = connections_.remove(conn);
+  channel->close();  // 清除messageCallback, 打破channel与conn之间的引用环
+  connectionCallback_(conn, nullptr);
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "goa-ev/src/Channel.hpp"
+#include "transport/Listener.hpp"
+#include "transport/ShmAddress.hpp"
+#include "transport/ShmChannel.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 共享内存传输的服务端
+在控制socket上accept客户端, 收到客户端的共享内存和eventfd后建立ShmChannel
+handles在控制socket可读时接收, 不阻塞loop线程, 超时未到达则关闭连接
+控制socket同样由TcpConnection管理, 作为上层看到的连接, 它断开时对应的ShmChannel随之关闭
+所有连接都在loop线程中处理
+*/
+class ShmServer : noncopyable {
+ public:
+  // 连接建立时channel非空, 断开时conn->connected()为false
+  using ShmConnectionCallback =
+      std::function<void(const TcpConnectionPtr&, const ShmChannelPtr&)>;
+
+  ShmServer(EventLoop* loop, const ShmAddress& local);
+  ~ShmServer();
+
+  void start();
+
+  void setConnectionCallback(const ShmConnectionCallback& callback) {
+    connectionCallback_ = callback;
+  }
+  // 从ShmChannel收到数据时调用, conn为对应的控制连接
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+
+ private:
+  // 已accept但尚未收到handles的控制socket
+  struct Handshake {
+    Handshake(EventLoop* loop, int fd) : channel(loop, fd) {}
+    ev::Channel channel;
+    ev::Timer* timer = nullptr;
+  };
+
+  void newHandshake(int connfd);
+  void handleHandshake(int connfd);
+  void removeHandshake(int connfd);
+  void newConnection(int connfd, const ShmHandles& handles);
+  void closeConnection(const TcpConnectionPtr& conn);
+
+  EventLoop* loop_;
+  ShmAddress local_;
+  Listener listener_;
+  std::map<int, std::shared_ptr<Handshake>> handshakes_;
+  ConnectionMap<ShmChannelPtr> connections_;
+  ShmConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
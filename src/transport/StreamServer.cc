@@ -0,0 +1,54 @@
+#include "transport/StreamServer.hpp"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace goa {
+
+namespace rpc {
+
+StreamServer::StreamServer(EventLoop* loop, int listenFd,
+                           const std::string& name, const InetAddress& local,
+                           bool tcpNoDelay)
+    : loop_(loop),
+      local_(local),
+      tcpNoDelay_(tcpNoDelay),
+      listener_(loop, listenFd, name),
+      connectionCallback_(ev::defaultConnectionCallback),
+      messageCallback_(ev::defaultMessageCallback) {
+  listener_.setNewConnectionCallback(
+      [this](int connfd, const InetAddress& peer) {
+        newConnection(connfd, peer);
+      });
+}
+
+StreamServer::~StreamServer() { connections_.forceCloseAll(); }
+
+void StreamServer::start() { listener_.start(); }
+
+void StreamServer::newConnection(int connfd, const InetAddress& peer) {
+  if (tcpNoDelay_) {
+    int on = 1;
+    ::setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  }
+
+  // TcpConnection只对fd做read/write, 对Unix domain socket同样适用
+  auto conn = std::make_shared<TcpConnection>(loop_, connfd, local_, peer);
+  connections_.add(conn, {});
+  conn->setMessageCallback(messageCallback_);
+  conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setCloseCallback([this](const TcpConnectionPtr& c) { closeConnection(c); });
+  conn->connectEstablished();
+  connectionCallback_(conn);
+}
+
+void StreamServer::closeConnection(const TcpConnectionPtr& conn) {
+  loop_->assertInLoopThread();
+  connections_.remove(conn);
+  connectionCallback_(conn);
+}
+
+}  // namespace rpc
+
+}  // namespace goa
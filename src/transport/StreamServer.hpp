@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <variant>
+
+#include "transport/Listener.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 接受的连接由TcpConnection管理的server, 上层的分帧、分发逻辑与TcpServer完全相同
+// 子类只负责创建监听socket, 见ReusePortServer和UnixServer. 所有连接都在loop线程中处理
+class StreamServer : noncopyable {
+ public:
+  ~StreamServer();
+
+  void start();
+
+  void setConnectionCallback(const ConnectionCallback& callback) {
+    connectionCallback_ = callback;
+  }
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+  void setWriteCompleteCallback(const WriteCompleteCallback& callback) {
+    writeCompleteCallback_ = callback;
+  }
+
+ protected:
+  // listenFd见Listener; local作为连接的本端地址, tcpNoDelay为true时对连接设置TCP_NODELAY
+  StreamServer(EventLoop* loop, int listenFd, const std::string& name,
+               const InetAddress& local, bool tcpNoDelay);
+
+ private:
+  void newConnection(int connfd, const InetAddress& peer);
+  void closeConnection(const TcpConnectionPtr& conn);
+
+  EventLoop* loop_;
+  InetAddress local_;
+  bool tcpNoDelay_;
+  Listener listener_;
+  ConnectionMap<std::monostate> connections_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
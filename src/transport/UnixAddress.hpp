@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+namespace goa {
+
+namespace rpc {
+
+// Unix domain socket地址, 用于同一主机上进程间的RPC, 省去TCP回环的协议栈开销
+class UnixAddress {
+ public:
+  explicit UnixAddress(std::string path) : path_(std::move(path)) {}
+
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,85 @@
+#include "transport/UnixClient.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+#include "transport/UnixSocket.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+const std::chrono::milliseconds kInitRetryDelay = 500ms;
+const std::chrono::milliseconds kMaxRetryDelay = 30s;
+
+}  // anonymous namespace
+
+UnixClient::UnixClient(EventLoop* loop, const UnixAddress& peer)
+    : loop_(loop),
+      peer_(peer),
+      started_(false),
+      retryDelay_(kInitRetryDelay),
+      connectionCallback_(ev::defaultConnectionCallback),
+      messageCallback_(ev::defaultMessageCallback) {}
+
+UnixClient::~UnixClient() {
+  if (connection_ && !connection_->disconnected()) {
+    connection_->forceClose();
+  }
+}
+
+void UnixClient::start() {
+  if (started_) return;
+  started_ = true;
+  loop_->runInLoop([this]() { connect(); });
+}
+
+void UnixClient::connect() {
+  loop_->assertInLoopThread();
+
+  int fd = connectUnixSocket(peer_.path());
+  if (fd != -1) {
+    retryDelay_ = kInitRetryDelay;
+    newConnection(fd);
+    return;
+  }
+
+  // ENOENT/ECONNREFUSED: 服务端尚未启动, EAGAIN: 服务端backlog已满
+  WARN("UnixClient::connect() {} {}", peer_.path(), strerror(errno));
+  retry();
+}
+
+void UnixClient::retry() {
+  INFO("UnixClient::retry() reconnect {} after {}ms", peer_.path(),
+       retryDelay_.count());
+  loop_->runAfter(retryDelay_, [this]() { connect(); });
+  retryDelay_ = std::min(retryDelay_ * 2, kMaxRetryDelay);
+}
+
+void UnixClient::newConnection(int connfd) {
+  // Unix socket没有ip:port, 使用空的InetAddress占位
+  auto conn =
+      std::make_shared<TcpConnection>(loop_, connfd, InetAddress(), InetAddress());
+  conn->setMessageCallback(messageCallback_);
+  conn->setWriteCompleteCallback(writeCompleteCallback_);
+  conn->setCloseCallback([this](const TcpConnectionPtr& c) { closeConnection(c); });
+  connection_ = conn;
+  conn->connectEstablished();
+  connectionCallback_(conn);
+}
+
+void UnixClient::closeConnection(const TcpConnectionPtr& conn) {
+  loop_->assertInLoopThread();
+  assert(connection_ == conn);
+  connectionCallback_(conn);
+  connection_.reset();
+}
+
+}  // namespace rpc
+
+}  // namespace goa
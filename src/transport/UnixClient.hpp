@@ -0,0 +1,47 @@
+#pragma once
+
+#include "transport/UnixAddress.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 连接Unix domain socket, 接口与TcpClient一致
+// 服务端尚未启动时按指数退避重试
+class UnixClient : noncopyable {
+ public:
+  UnixClient(EventLoop* loop, const UnixAddress& peer);
+  ~UnixClient();
+
+  void start();
+
+  void setConnectionCallback(const ConnectionCallback& callback) {
+    connectionCallback_ = callback;
+  }
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+  void setWriteCompleteCallback(const WriteCompleteCallback& callback) {
+    writeCompleteCallback_ = callback;
+  }
+
+ private:
+  void connect();
+  void retry();
+  void newConnection(int connfd);
+  void closeConnection(const TcpConnectionPtr& conn);
+
+  EventLoop* loop_;
+  UnixAddress peer_;
+  bool started_;
+  std::chrono::milliseconds retryDelay_;
+  TcpConnectionPtr connection_;
+  ConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+  WriteCompleteCallback writeCompleteCallback_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
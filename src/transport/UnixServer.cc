@@ -0,0 +1,20 @@
+#include "transport/UnixServer.hpp"
+
+#include <unistd.h>
+
+#include "transport/UnixSocket.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+UnixServer::UnixServer(EventLoop* loop, const UnixAddress& local)
+    : StreamServer(loop, createUnixListenSocket(local.path()),
+                   "UnixServer " + local.path(), InetAddress(), false),
+      local_(local) {}
+
+UnixServer::~UnixServer() { ::unlink(local_.path().c_str()); }
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "transport/StreamServer.hpp"
+#include "transport/UnixAddress.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 监听Unix domain socket, 接受的连接同样由TcpConnection管理,
+// 因此上层的分帧、分发逻辑与TcpServer完全相同. 所有连接都在loop线程中处理
+// Unix socket没有ip:port, 连接的两端地址都是空的InetAddress
+class UnixServer : public StreamServer {
+ public:
+  UnixServer(EventLoop* loop, const UnixAddress& local);
+  ~UnixServer();
+
+ private:
+  UnixAddress local_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
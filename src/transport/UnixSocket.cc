@@ -0,0 +1,67 @@
+#include "transport/UnixSocket.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+void toSockaddr(const std::string& path, struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr->sun_path)) {
+    FATAL("unix socket path {} is too long", path);
+  }
+  memcpy(addr->sun_path, path.c_str(), path.size() + 1);
+}
+
+int createUnixSocket() {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd == -1) {
+    FATAL("unix socket() {}", strerror(errno));
+  }
+  return fd;
+}
+
+}  // anonymous namespace
+
+int createUnixListenSocket(const std::string& path) {
+  struct sockaddr_un addr;
+  toSockaddr(path, &addr);
+
+  int fd = createUnixSocket();
+  ::unlink(path.c_str());  // 上次进程退出时残留的socket文件
+  if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) ==
+      -1) {
+    FATAL("unix socket bind() {} {}", path, strerror(errno));
+  }
+  return fd;
+}
+
+int connectUnixSocket(const std::string& path) {
+  struct sockaddr_un addr;
+  toSockaddr(path, &addr);
+
+  int fd = createUnixSocket();
+  if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) ==
+      -1) {
+    int savedErrno = errno;
+    ::close(fd);
+    errno = savedErrno;
+    return -1;
+  }
+  return fd;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace goa {
+
+namespace rpc {
+
+// 创建非阻塞的Unix domain socket并bind到path, 尚未listen, 失败时FATAL
+int createUnixListenSocket(const std::string& path);
+
+// 创建非阻塞的Unix domain socket并连接path
+// Unix domain socket的connect不会出现EINPROGRESS, 失败时返回-1, errno有效
+int connectUnixSocket(const std::string& path);
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,441 @@
+#include "transport/UringServer.hpp"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "goa-ev/src/Logger.hpp"
+#include "transport/ReusePortServer.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// sq大小, 一轮事件处理中提交的请求超过此数量时会提前提交一次
+const unsigned kRingEntries = 1024;
+// provided buffer的数量(必须是2的幂)和大小, 只有正在接收数据的连接才占用缓冲区
+const unsigned kRecvBufferCount = 1024;
+const size_t kRecvBufferSize = 16 * 1024;
+const uint16_t kRecvBufferGroup = 0;
+// 提交队列满且io_uring_enter返回EAGAIN/EBUSY时推迟的请求, 以及ENOBUFS之后
+// 没有等到缓冲区归还的连接, 最迟在此之后重试
+const std::chrono::milliseconds kSubmitRetryDelay = 1ms;
+
+}  // anonymous namespace
+
+UringConnection::UringConnection(UringServer* server, uint64_t id, int fd,
+                                 const TcpConnectionPtr& conn)
+    : server_(server),
+      loop_(conn->getLoop()),
+      id_(id),
+      fd_(fd),
+      conn_(conn),
+      recvArmed_(false),
+      sending_(false),
+      sendQueued_(false),
+      shutdownPending_(false),
+      readPaused_(false),
+      waitingBuffers_(false),
+      closed_(false) {}
+
+void UringConnection::send(Buffer& buf) {
+  if (loop_->isInLoopThread()) {
+    sendInLoop(std::string_view(buf.peek(), buf.readableBytes()));
+    buf.retrieveAll();
+  } else {
+    loop_->queueInLoop(
+        [self = shared_from_this(), data = buf.retrieveAllAsString()]() {
+          self->sendInLoop(data);
+        });
+  }
+}
+
+void UringConnection::shutdown() {
+  loop_->runInLoop([self = shared_from_this()]() { self->shutdownInLoop(); });
+}
+
+void UringConnection::stopRead() {
+  loop_->runInLoop([self = shared_from_this()]() {
+    if (self->closed_ || self->readPaused_) return;
+    self->readPaused_ = true;
+    if (self->recvArmed_) self->server_->cancelRecv(*self);
+  });
+}
+
+void UringConnection::startRead() {
+  loop_->runInLoop([self = shared_from_this()]() {
+    if (self->closed_ || !self->readPaused_) return;
+    self->readPaused_ = false;
+    self->server_->resumeRecv(*self);
+  });
+}
+
+void UringConnection::sendInLoop(std::string_view data) {
+  loop_->assertInLoopThread();
+  if (closed_ || shutdownPending_) return;
+  // 先追加到output_, 本轮事件处理结束时一起提交
+  output_.append(data.data(), data.size());
+  server_->queueSend(shared_from_this());
+}
+
+void UringConnection::shutdownInLoop() {
+  if (closed_ || shutdownPending_) return;
+  shutdownPending_ = true;
+  if (!sending_ && !sendQueued_ && output_.readableBytes() == 0) {
+    if (auto conn = conn_.lock()) conn->shutdown();
+  }
+}
+
+UringServer::UringServer(EventLoop* loop, const InetAddress& local)
+    : loop_(loop),
+      local_(local),
+      listener_(loop, createReusePortListenSocket(local),
+                "UringServer " + local.toIpPort()),
+      started_(false),
+      handlingCompletions_(false),
+      submitScheduled_(false),
+      nextId_(0),
+      recycled_(false),
+      retryTimer_(nullptr),
+      ring_(kRingEntries),
+      bufRing_(ring_, kRecvBufferGroup, kRecvBufferCount, kRecvBufferSize),
+      eventFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      eventChannel_(loop, eventFd_),
+      messageCallback_(ev::defaultMessageCallback) {
+  if (eventFd_ == -1) {
+    FATAL("UringServer eventfd() {}", strerror(errno));
+  }
+  ring_.registerEventFd(eventFd_);
+  listener_.setNewConnectionCallback(
+      [this](int connfd, const InetAddress& peer) {
+        newConnection(connfd, peer);
+      });
+}
+
+UringServer::~UringServer() {
+  connections_.forceCloseAll();
+  if (retryTimer_ != nullptr) loop_->cancelTimer(retryTimer_);
+  if (started_) eventChannel_.disableAll();
+  ::close(eventFd_);
+}
+
+void UringServer::start() {
+  if (started_) return;
+  started_ = true;
+  loop_->runInLoop([this]() {
+    eventChannel_.setReadCallback([this]() { handleCompletions(); });
+    eventChannel_.enableRead();
+  });
+  listener_.start();
+}
+
+void UringServer::newConnection(int connfd, const InetAddress& peer) {
+  int on = 1;
+  ::setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+  auto conn = std::make_shared<TcpConnection>(loop_, connfd, local_, peer);
+  // epoll不再读这个fd, 只用于感知错误和挂断
+  conn->setMessageCallback(
+      [](const TcpConnectionPtr&, Buffer& buf) { buf.retrieveAll(); });
+  conn->setCloseCallback([this](const TcpConnectionPtr& c) { closeConnection(c); });
+  conn->connectEstablished();
+  conn->stopRead();
+
+  auto uconn = std::make_shared<UringConnection>(this, nextId_++, connfd, conn);
+  connections_.add(conn, uconn);
+  inflight_.emplace(uconn->id_, uconn);
+  // 先通知上层建立连接上下文, 再开始接收request
+  connectionCallback_(conn, uconn);
+  armRecv(*uconn);
+  requestSubmit();  // 一轮accept的所有新连接的recv一起提交
+}
+
+void UringServer::closeConnection(const TcpConnectionPtr& conn) {
+  loop_->assertInLoopThread();
+  auto uconn = connections_.remove(conn);
+
+  uconn->closed_ = true;
+  uconn->output_.retrieveAll();
+  // fd关闭不会终止io_uring中的recv, 需要显式取消
+  if (uconn->recvArmed_) cancelRecv(*uconn);
+  connectionCallback_(conn, nullptr);
+  release(*uconn);
+}
+
+void UringServer::handleCompletions() {
+  uint64_t count;
+  // EAGAIN表示计数已被清空, completion仍按cq中的实际内容处理
+  if (::read(eventFd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+    ERROR("UringServer::handleCompletions() read eventfd {}", strerror(errno));
+  }
+
+  handlingCompletions_ = true;
+  recycled_ = false;
+  ring_.forEachCqe([this](const struct io_uring_cqe& cqe) {
+    uint64_t id = cqe.user_data >> 2;
+    auto op = static_cast<Op>(cqe.user_data & 3);
+    auto it = inflight_.find(id);
+    if (it == inflight_.end()) {
+      // 连接已经释放, 只需归还缓冲区
+      if (cqe.flags & IORING_CQE_F_BUFFER) {
+        bufRing_.recycle(
+            static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        recycled_ = true;
+      }
+      return;
+    }
+    auto uconn = it->second;  // 处理过程中连接可能被释放
+    if (op == RECV) {
+      handleRecv(*uconn, cqe);
+    } else if (op == SEND) {
+      handleSend(*uconn, cqe);
+    }
+  });
+  handlingCompletions_ = false;
+
+  if (!bufferWaiters_.empty()) {
+    if (recycled_) {
+      rearmBufferWaiters();
+    } else {
+      scheduleRetry();
+    }
+  }
+  // 本轮产生的所有send和重新提交的recv只需一次io_uring_enter
+  flushDeferred();
+  flushSends();
+  ring_.submit();
+}
+
+void UringServer::handleRecv(UringConnection& uconn,
+                             const struct io_uring_cqe& cqe) {
+  if (!(cqe.flags & IORING_CQE_F_MORE)) uconn.recvArmed_ = false;
+
+  if (cqe.res > 0) {
+    auto bufferId = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    if (!uconn.closed_) {
+      uconn.input_.append(bufRing_.buffer(bufferId),
+                          static_cast<size_t>(cqe.res));
+    }
+    bufRing_.recycle(bufferId);
+    recycled_ = true;
+    // 暂停期间取消生效之前到达的数据先留在input_中
+    if (!uconn.closed_ && !uconn.readPaused_) {
+      if (auto conn = uconn.conn_.lock()) messageCallback_(conn, uconn.input_);
+    }
+    if (!uconn.closed_ && !uconn.readPaused_ && !uconn.recvArmed_) {
+      armRecv(uconn);
+    }
+  } else if (cqe.res == -ENOBUFS) {
+    // provided buffer暂时用完, recv已终止, 等有缓冲区归还之后再重新提交
+    if (!uconn.closed_ && !uconn.readPaused_ && !uconn.recvArmed_ &&
+        !uconn.waitingBuffers_) {
+      uconn.waitingBuffers_ = true;
+      bufferWaiters_.push_back(uconn.shared_from_this());
+    }
+  } else if (cqe.res == -ECANCELED) {
+    // 暂停读或关闭连接时取消, 取消生效前可能已经恢复读
+    if (!uconn.closed_ && !uconn.readPaused_ && !uconn.recvArmed_) {
+      armRecv(uconn);
+    }
+  } else if (!uconn.closed_) {
+    // 0为对端关闭, 其余为出错
+    if (cqe.res < 0) {
+      WARN("UringServer recv() {}", strerror(-cqe.res));
+    }
+    if (auto conn = uconn.conn_.lock()) conn->forceClose();
+  }
+  release(uconn);
+}
+
+void UringServer::handleSend(UringConnection& uconn,
+                             const struct io_uring_cqe& cqe) {
+  uconn.sending_ = false;
+  if (uconn.closed_) {
+    uconn.sendingBuffer_.retrieveAll();
+    release(uconn);
+    return;
+  }
+
+  if (cqe.res < 0) {
+    WARN("UringServer send() {}", strerror(-cqe.res));
+    uconn.sendingBuffer_.retrieveAll();
+    if (auto conn = uconn.conn_.lock()) conn->forceClose();
+    return;
+  }
+
+  uconn.sendingBuffer_.retrieve(static_cast<size_t>(cqe.res));
+  if (uconn.sendingBuffer_.readableBytes() > 0) {
+    prepareSend(uconn);  // 只发出了一部分, 继续发送剩余部分
+  } else if (uconn.output_.readableBytes() > 0) {
+    queueSend(uconn.shared_from_this());
+  } else if (uconn.shutdownPending_) {
+    if (auto conn = uconn.conn_.lock()) conn->shutdown();
+  }
+}
+
+void UringServer::armRecv(UringConnection& uconn) {
+  uconn.recvArmed_ = true;
+  auto sqe = ring_.getSqe();
+  if (sqe == nullptr) {
+    deferOp(uconn, RECV);
+    return;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = uconn.fd_;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = bufRing_.groupId();
+  sqe->user_data = userData(uconn.id_, RECV);
+}
+
+// recv的cqe以ECANCELED结束后recvArmed_才清除
+void UringServer::cancelRecv(UringConnection& uconn) {
+  auto sqe = ring_.getSqe();
+  if (sqe == nullptr) {
+    deferOp(uconn, CANCEL);
+    return;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = userData(uconn.id_, RECV);
+  sqe->user_data = userData(uconn.id_, CANCEL);
+  requestSubmit();
+}
+
+// 先处理暂停期间收到的数据, 上层可能再次暂停
+void UringServer::resumeRecv(UringConnection& uconn) {
+  if (uconn.input_.readableBytes() > 0) {
+    if (auto conn = uconn.conn_.lock()) messageCallback_(conn, uconn.input_);
+  }
+  // 等待缓冲区的连接由rearmBufferWaiters提交
+  if (!uconn.closed_ && !uconn.readPaused_ && !uconn.recvArmed_ &&
+      !uconn.waitingBuffers_) {
+    armRecv(uconn);
+    requestSubmit();
+  }
+}
+
+void UringServer::prepareSend(UringConnection& uconn) {
+  uconn.sending_ = true;
+  auto sqe = ring_.getSqe();
+  if (sqe == nullptr) {
+    deferOp(uconn, SEND);
+    return;
+  }
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = uconn.fd_;
+  sqe->addr = reinterpret_cast<uint64_t>(uconn.sendingBuffer_.peek());
+  sqe->len = static_cast<uint32_t>(uconn.sendingBuffer_.readableBytes());
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = userData(uconn.id_, SEND);
+}
+
+void UringServer::queueSend(const UringConnectionPtr& uconn) {
+  if (uconn->sending_ || uconn->sendQueued_) return;
+  uconn->sendQueued_ = true;
+  sendQueue_.push_back(uconn);
+  requestSubmit();
+}
+
+// 每个连接同时只有一个send在内核中, 保证字节流的顺序
+void UringServer::flushSends() {
+  for (auto& uconn : sendQueue_) {
+    uconn->sendQueued_ = false;
+    if (uconn->closed_ || uconn->sending_ ||
+        uconn->output_.readableBytes() == 0) {
+      continue;
+    }
+    uconn->sendingBuffer_.swap(uconn->output_);
+    prepareSend(*uconn);
+  }
+  sendQueue_.clear();
+}
+
+// 处理完成事件时最后统一提交, 其他时候(线程池中产生的response、定时flush等)
+// 安排在本轮事件循环末尾提交, 同一轮内的多个send仍然合并
+void UringServer::requestSubmit() {
+  if (handlingCompletions_ || submitScheduled_) return;
+  submitScheduled_ = true;
+  loop_->queueInLoop([this]() {
+    submitScheduled_ = false;
+    flushDeferred();
+    flushSends();
+    ring_.submit();
+  });
+}
+
+void UringServer::deferOp(UringConnection& uconn, Op op) {
+  deferredOps_.emplace_back(uconn.shared_from_this(), op);
+  scheduleRetry();
+}
+
+void UringServer::scheduleRetry() {
+  if (retryTimer_ != nullptr) return;
+  retryTimer_ = loop_->runAfter(kSubmitRetryDelay, [this]() {
+    retryTimer_ = nullptr;
+    rearmBufferWaiters();
+    requestSubmit();
+  });
+}
+
+// 暂停读或关闭的连接不再提交, 恢复读时由resumeRecv提交
+void UringServer::rearmBufferWaiters() {
+  std::vector<UringConnectionPtr> waiters;
+  waiters.swap(bufferWaiters_);
+  for (auto& uconn : waiters) {
+    uconn->waitingBuffers_ = false;
+    if (!uconn->closed_ && !uconn->readPaused_ && !uconn->recvArmed_) {
+      armRecv(*uconn);
+    }
+  }
+}
+
+// 按推迟的顺序重新准备, 队列仍满时再次推迟
+void UringServer::flushDeferred() {
+  std::vector<std::pair<UringConnectionPtr, Op>> ops;
+  ops.swap(deferredOps_);
+  for (auto& [uconn, op] : ops) {
+    switch (op) {
+      case RECV:
+        if (uconn->closed_ || uconn->readPaused_) {
+          // 尚未提交, 不需要取消
+          uconn->recvArmed_ = false;
+          release(*uconn);
+        } else {
+          armRecv(*uconn);
+        }
+        break;
+      case SEND:
+        if (uconn->closed_) {
+          uconn->sending_ = false;
+          uconn->sendingBuffer_.retrieveAll();
+          release(*uconn);
+        } else {
+          prepareSend(*uconn);
+        }
+        break;
+      case CANCEL:
+        // recv也被推迟时在上面已经丢弃
+        if (uconn->recvArmed_) cancelRecv(*uconn);
+        break;
+    }
+  }
+}
+
+// 连接已关闭且内核中没有它的请求时才释放, 之前缓冲区必须保持有效
+void UringServer::release(UringConnection& uconn) {
+  if (uconn.closed_ && !uconn.recvArmed_ && !uconn.sending_) {
+    inflight_.erase(uconn.id_);
+  }
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "goa-ev/src/Channel.hpp"
+#include "transport/IoUring.hpp"
+#include "transport/Listener.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+class UringServer;
+
+/* io_uring上的一个连接
+TcpConnection仍然持有fd并作为上层看到的连接, 但不再通过epoll读写,
+数据的接收和发送都经过所属UringServer的io_uring
+*/
+class UringConnection : noncopyable,
+                        public std::enable_shared_from_this<UringConnection> {
+ public:
+  UringConnection(UringServer* server, uint64_t id, int fd,
+                  const TcpConnectionPtr& conn);
+
+  // 可以在任意线程中调用, 取走buf中的全部数据
+  void send(Buffer& buf);
+  // 可以在任意线程中调用, 已交给send的数据全部发出后关闭写端
+  void shutdown();
+  // 可以在任意线程中调用, 暂停时取消recv, 已收到的数据在恢复后交给上层
+  void stopRead();
+  void startRead();
+
+ private:
+  friend class UringServer;
+
+  void sendInLoop(std::string_view data);
+  void shutdownInLoop();
+
+  UringServer* server_;
+  EventLoop* loop_;
+  const uint64_t id_;
+  const int fd_;
+  std::weak_ptr<TcpConnection> conn_;
+
+  bool recvArmed_;         // multishot recv仍然有效
+  bool sending_;           // 有一个send在内核中, 期间sendingBuffer_不能改动
+  bool sendQueued_;        // 已加入UringServer的待发送队列
+  bool shutdownPending_;
+  bool readPaused_;
+  bool waitingBuffers_;    // recv因provided buffer用完而终止, 等待缓冲区归还后重新提交
+  bool closed_;            // TcpConnection已关闭, 只等待未完成的请求结束
+  Buffer input_;
+  Buffer output_;          // 等待提交的数据
+  Buffer sendingBuffer_;   // 正在发送的数据
+};
+
+using UringConnectionPtr = std::shared_ptr<UringConnection>;
+
+/* 使用io_uring收发数据的TCP server, 所有连接都在loop线程中处理
+监听socket设置SO_REUSEPORT, 可以与ShardedRpcServer一起每个核一个实例
+- 接收: 每个连接一个multishot recv, 从provided buffer ring中取缓冲区, 不需要每次重新提交
+- 发送: 一轮事件处理中产生的send先排队, 最后与重新提交的recv一起只调用一次io_uring_enter
+- 完成事件通过注册的eventfd通知EventLoop, 因此仍然和其他Channel一起由epoll等待
+accept仍然通过epoll, 连接建立不在热路径上
+*/
+class UringServer : noncopyable {
+ public:
+  // 连接建立时uring非空, 断开时conn->connected()为false
+  using UringConnectionCallback =
+      std::function<void(const TcpConnectionPtr&, const UringConnectionPtr&)>;
+
+  UringServer(EventLoop* loop, const InetAddress& local);
+  ~UringServer();
+
+  void start();
+
+  void setConnectionCallback(const UringConnectionCallback& callback) {
+    connectionCallback_ = callback;
+  }
+  void setMessageCallback(const MessageCallback& callback) {
+    messageCallback_ = callback;
+  }
+
+ private:
+  friend class UringConnection;
+
+  enum Op : uint64_t {
+    RECV = 0,
+    SEND = 1,
+    CANCEL = 2,
+  };
+  static uint64_t userData(uint64_t id, Op op) { return id << 2 | op; }
+
+  void newConnection(int connfd, const InetAddress& peer);
+  void closeConnection(const TcpConnectionPtr& conn);
+
+  void handleCompletions();
+  void handleRecv(UringConnection& uconn, const struct io_uring_cqe& cqe);
+  void handleSend(UringConnection& uconn, const struct io_uring_cqe& cqe);
+  void armRecv(UringConnection& uconn);
+  void cancelRecv(UringConnection& uconn);
+  void resumeRecv(UringConnection& uconn);
+  void prepareSend(UringConnection& uconn);
+  void queueSend(const UringConnectionPtr& uconn);
+  void flushSends();
+  void requestSubmit();
+  void release(UringConnection& uconn);
+  // 提交队列满且内核暂时无法接收时, 请求推迟到下次提交之前重新准备
+  void deferOp(UringConnection& uconn, Op op);
+  void flushDeferred();
+  void scheduleRetry();
+  // 有缓冲区归还之后重新提交等待缓冲区的连接的recv
+  void rearmBufferWaiters();
+
+  EventLoop* loop_;
+  InetAddress local_;
+  Listener listener_;
+  bool started_;
+  bool handlingCompletions_;
+  bool submitScheduled_;
+  uint64_t nextId_;
+  ConnectionMap<UringConnectionPtr> connections_;
+  // 还有请求在内核中的连接, 包括已关闭的, 以cqe中的id查找
+  std::unordered_map<uint64_t, UringConnectionPtr> inflight_;
+  std::vector<UringConnectionPtr> sendQueue_;
+  // 推迟的请求期间recvArmed_/sending_保持为true, 重试时连接可能已关闭或暂停读
+  std::vector<std::pair<UringConnectionPtr, Op>> deferredOps_;
+  // ENOBUFS之后等待缓冲区的连接, 立即重新提交只会再次得到ENOBUFS
+  std::vector<UringConnectionPtr> bufferWaiters_;
+  bool recycled_;  // 本轮处理完成事件时归还了缓冲区
+  // 没有完成事件时也能重试推迟的请求和等待缓冲区的连接
+  ev::Timer* retryTimer_;
+  // 在连接之后声明, 先于连接析构, 保证内核不再引用连接的缓冲区
+  IoUring ring_;
+  IoUringBufRing bufRing_;
+  int eventFd_;
+  ev::Channel eventChannel_;
+  UringConnectionCallback connectionCallback_;
+  MessageCallback messageCallback_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string_view>
+
+#include "goa-json/include/Document.hpp"
+#include "goa-json/include/Exception.hpp"
+#include "goa-json/include/Value.hpp"
+#include "goa-json/include/Writer.hpp"
+#include "utils/Frame.hpp"
+#include "utils/MsgPack.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* body的编码方式, 位于分帧与json::Value之间
+分帧只负责确定body的边界, 编码方式只负责body与json::Value之间的转换,
+json-rpc的语义(request/response/batch/notify)与编码方式无关
+增加编码方式时在CodecId中添加, 并在以下两个函数中分发
+*/
+
+// 把value编码后追加到buf末尾
+inline void writeBody(Buffer& buf, CodecId codec, const json::Value& value) {
+  switch (codec) {
+    case CodecId::JSON: {
+      BufferWriteStream os(buf);
+      json::Writer writer(os);
+      value.writeTo(writer);
+      break;
+    }
+    case CodecId::MSGPACK:
+      writeMsgPack(buf, value);
+      break;
+  }
+}
+
+// 成功的response, 与把{"jsonrpc":"2.0","id":id,"result":result}交给writeBody的结果相同
+inline void writeResultBody(Buffer& buf, CodecId codec, const json::Value& id,
+                            const json::Value& result) {
+  switch (codec) {
+    case CodecId::JSON: {
+      BufferWriteStream os(buf);
+      os.put(R"({"jsonrpc":"2.0","id":)");
+      json::Writer idWriter(os);
+      id.writeTo(idWriter);
+      os.put(R"(,"result":)");
+      json::Writer resultWriter(os);
+      result.writeTo(resultWriter);
+      os.put('}');
+      break;
+    }
+    case CodecId::MSGPACK:
+      writeMsgPackResult(buf, id, result);
+      break;
+  }
+}
+
+// batch的结果集按顺序写成array, 跳过其中为null的项
+inline void writeBatchBody(Buffer& buf, CodecId codec,
+                           const json::Value* responses, size_t count) {
+  switch (codec) {
+    case CodecId::JSON: {
+      BufferWriteStream os(buf);
+      os.put('[');
+      bool first = true;
+      for (size_t i = 0; i < count; i++) {
+        if (responses[i].isNull()) continue;
+        if (!first) os.put(',');
+        first = false;
+        json::Writer writer(os);
+        responses[i].writeTo(writer);
+      }
+      os.put(']');
+      break;
+    }
+    case CodecId::MSGPACK: {
+      size_t size = 0;
+      for (size_t i = 0; i < count; i++) size += !responses[i].isNull();
+      writeMsgPackArrayHeader(buf, size);
+      for (size_t i = 0; i < count; i++) {
+        if (!responses[i].isNull()) writeMsgPack(buf, responses[i]);
+      }
+      break;
+    }
+  }
+}
+
+// 把body解析到doc中, 成功返回nullptr, 否则返回错误描述
+// doc持有自己的数据, 不引用body
+inline const char* parseBody(CodecId codec, std::string_view body,
+                             json::Document& doc) {
+  switch (codec) {
+    case CodecId::JSON: {
+      auto err = doc.parse(body.data(), body.size());
+      return err == json::ParseError::PARSE_OK ? nullptr
+                                               : json::parseErrorString(err);
+    }
+    case CodecId::MSGPACK:
+      return readMsgPack(body, doc);
+  }
+  return "unknown codec";
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+
+namespace goa {
+
+namespace rpc {
+
+/* request的截止时间, 由request中可选的"timeout"字段(毫秒)换算得到,
+从server读到该帧最后一个字节时开始计算, 因并发上限而在连接上排队的时间也计算在内
+以server自己的steady_clock计时, 不依赖客户端与服务端的时钟同步
+截止时间已过的request在调用method之前就以错误回复, 见RpcServer
+*/
+class Deadline {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using TimePoint = Clock::time_point;
+
+  // 超过此值的timeout视为没有截止时间, 客户端常用极大的值表示不限时,
+  // 直接加到steady_clock的纳秒计数上会溢出
+  static constexpr std::chrono::milliseconds kMaxTimeout =
+      std::chrono::hours(24 * 365);
+
+  // 没有截止时间
+  Deadline() = default;
+  Deadline(TimePoint received, std::chrono::milliseconds timeout)
+      : when_(timeout <= kMaxTimeout ? received + timeout : TimePoint()),
+        has_(timeout <= kMaxTimeout) {}
+
+  bool has() const { return has_; }
+  bool expired() const { return has_ && Clock::now() >= when_; }
+  // has()为false时没有意义
+  TimePoint when() const { return when_; }
+
+  // 没有截止时间时为milliseconds::max(), 已过期时为0
+  std::chrono::milliseconds remaining() const {
+    if (!has_) return std::chrono::milliseconds::max();
+    auto left = when_ - Clock::now();
+    if (left <= Clock::duration::zero()) return std::chrono::milliseconds(0);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(left);
+  }
+
+  // 当前线程正在调用的method所属request的截止时间, 只在RpcServer调用procedure期间有效
+  // UserDoneCallback在构造时记录, 之后在其他线程中也可以通过它取得
+  static const Deadline& current() { return currentRef(); }
+
+  // 在作用域内设置current()
+  class Scope;
+
+ private:
+  static Deadline& currentRef() {
+    thread_local Deadline deadline;
+    return deadline;
+  }
+
+  TimePoint when_{};
+  bool has_ = false;
+};
+
+class Deadline::Scope {
+ public:
+  explicit Scope(const Deadline& deadline) : saved_(currentRef()) {
+    currentRef() = deadline;
+  }
+  ~Scope() { currentRef() = saved_; }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  Deadline saved_;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
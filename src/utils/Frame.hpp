@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace goa {
+
+namespace rpc {
+
+/* 分帧方式
+TEXT:   header为十进制的body长度(左侧可补空格), 内存分布为 header + "\r\n" + body + "\r\n"
+BINARY: header为定长8字节, 内存分布为 header + body
+
+BINARY header格式(多字节字段为大端序):
+| magic(1) | flags(1) | codec(1) | reserved(1) | length(4) |
+magic不是ASCII数字, 服务端据此在连接的第一帧判断对端使用的分帧方式
+codec为body的编码方式, 由连接的第一帧确定(握手), 之后双方的帧都必须使用相同的编码方式,
+TEXT和HTTP分帧没有codec字段, 固定为JSON
+
+HTTP:   HTTP/1.1 POST request, body为json, 只用于服务端
+        支持Content-Length和chunked两种body, keep-alive和pipelining
+        request line以大写的method开头, 因此也可以通过首字节与前两种区分
+*/
+enum class FramingMode : uint8_t {
+  UNKNOWN,  // 服务端尚未收到第一帧
+  TEXT,     // 默认
+  BINARY,
+  HTTP,
+};
+
+// body的编码方式, 见utils/Codec.hpp
+enum class CodecId : uint8_t {
+  JSON = 0,
+  MSGPACK = 1,  // 数值较多时省去文本格式化和解析的开销
+};
+
+inline bool isKnownCodec(CodecId codec) {
+  return codec == CodecId::JSON || codec == CodecId::MSGPACK;
+}
+
+// HTTP分帧时response的状态码
+enum class HttpStatus {
+  OK = 200,
+  NO_CONTENT = 204,  // notify没有response
+  BAD_REQUEST = 400,
+};
+
+struct FrameHeader {
+  uint32_t length = 0;  // body长度, 不含header
+  uint8_t flags = 0;    // 保留, 目前必须为0
+  CodecId codec = CodecId::JSON;
+};
+
+// 文本header定宽: 右对齐的十进制长度, 左侧补空格, 再加"\r\n"
+// 对端按json解析header时空格属于空白字符, 因此与旧的变长header兼容
+constexpr size_t kTextHeaderDigits = 10;
+constexpr size_t kTextHeaderLen = kTextHeaderDigits + 2;
+
+constexpr uint8_t kFrameMagic = 0xBF;
+constexpr size_t kFrameHeaderLen = 8;
+
+inline bool isBinaryFrame(const char* data) {
+  return static_cast<uint8_t>(*data) == kFrameMagic;
+}
+
+inline bool isHttpFrame(const char* data) { return *data >= 'A' && *data <= 'Z'; }
+
+// 根据第一帧的首字节判断分帧方式
+inline FramingMode sniffFramingMode(const char* data) {
+  if (isBinaryFrame(data)) return FramingMode::BINARY;
+  if (isHttpFrame(data)) return FramingMode::HTTP;
+  return FramingMode::TEXT;
+}
+
+// dst至少要有kFrameHeaderLen字节
+inline void encodeFrameHeader(char* dst, const FrameHeader& header) {
+  auto* p = reinterpret_cast<uint8_t*>(dst);
+  p[0] = kFrameMagic;
+  p[1] = header.flags;
+  p[2] = static_cast<uint8_t>(header.codec);
+  p[3] = 0;
+  p[4] = static_cast<uint8_t>(header.length >> 24);
+  p[5] = static_cast<uint8_t>(header.length >> 16);
+  p[6] = static_cast<uint8_t>(header.length >> 8);
+  p[7] = static_cast<uint8_t>(header.length);
+}
+
+// src至少要有kFrameHeaderLen字节, 且isBinaryFrame(src)为true
+inline FrameHeader decodeFrameHeader(const char* src) {
+  auto* p = reinterpret_cast<const uint8_t*>(src);
+  FrameHeader header;
+  header.flags = p[1];
+  header.codec = static_cast<CodecId>(p[2]);
+  header.length = static_cast<uint32_t>(p[4]) << 24 |
+                  static_cast<uint32_t>(p[5]) << 16 |
+                  static_cast<uint32_t>(p[6]) << 8 | static_cast<uint32_t>(p[7]);
+  return header;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,410 @@
+#include "utils/FrameDecoder.hpp"
+
+#include <strings.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string_view>
+
+#include "utils/SimdScan.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 文本header为十进制长度, 允许前后有空格, 超过此长度仍未找到crlf视为非法
+const size_t kMaxTextHeaderLen = 32;
+// HTTP request line和所有header字段的总长度上限, trailer同样适用
+const size_t kMaxHttpHeaderLen = 8192;
+// chunk size行的长度上限, 包括chunk extension
+const size_t kMaxChunkLineLen = 256;
+// 一个chunked body中chunk数量的上限, 限制body之后等待丢弃的chunk size行的总长度
+const size_t kMaxChunks = 8192;
+
+bool equalsIgnoreCase(std::string_view lhs, std::string_view rhs) {
+  return lhs.size() == rhs.size() &&
+         strncasecmp(lhs.data(), rhs.data(), lhs.size()) == 0;
+}
+
+// 去掉首尾的空格和tab
+std::string_view trim(std::string_view str) {
+  while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+    str.remove_prefix(1);
+  while (!str.empty() && (str.back() == ' ' || str.back() == '\t'))
+    str.remove_suffix(1);
+  return str;
+}
+
+// 逗号分隔的列表中最后一项
+std::string_view lastToken(std::string_view list) {
+  auto pos = list.rfind(',');
+  return trim(pos == std::string_view::npos ? list : list.substr(pos + 1));
+}
+
+// 逗号分隔的列表中是否有token
+bool hasToken(std::string_view list, std::string_view token) {
+  while (!list.empty()) {
+    auto pos = list.find(',');
+    if (equalsIgnoreCase(trim(list.substr(0, pos)), token)) return true;
+    if (pos == std::string_view::npos) break;
+    list.remove_prefix(pos + 1);
+  }
+  return false;
+}
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+}  // anonymous namespace
+
+FrameDecoder::Status FrameDecoder::decode(Buffer& buf) {
+  if (state_ == State::HEADER) {
+    if (mode_ == FramingMode::UNKNOWN) {
+      if (buf.readableBytes() == 0) return Status::INCOMPLETE;
+      mode_ = sniffFramingMode(buf.peek());
+    }
+
+    Status status;
+    switch (mode_) {
+      case FramingMode::BINARY:
+        status = decodeBinaryHeader(buf);
+        break;
+      case FramingMode::HTTP:
+        status = decodeHttpHeader(buf);
+        break;
+      default:
+        status = decodeTextHeader(buf);
+        break;
+    }
+    if (status != Status::FRAME) return status;
+    if (state_ == State::HEADER) state_ = State::BODY;  // chunked body另行处理
+  }
+
+  if (state_ != State::BODY) {
+    auto status = decodeChunkedBody(buf);
+    if (status != Status::FRAME) return status;
+  }
+
+  // header已经取走, 只需等待body到齐
+  if (buf.readableBytes() < header_.length) return Status::INCOMPLETE;
+  return Status::FRAME;
+}
+
+void FrameDecoder::consume(Buffer& buf) {
+  assert(state_ == State::BODY);
+  buf.retrieve(frameBytes());
+  reset();
+}
+
+// header + "\r\n", header为十进制的body长度(含body末尾的"\r\n")
+FrameDecoder::Status FrameDecoder::decodeTextHeader(Buffer& buf) {
+  while (true) {
+    size_t readable = buf.readableBytes();
+    // 流水线中的帧通常使用FrameWriter的定宽header, 不需要查找'\n'
+    uint64_t length = 0;
+    if (scanned_ == 0 && readable >= 16 &&
+        parseFixedTextHeader(buf.peek(), &length)) {
+      if (length == 0) {
+        return fail("invalid message header");
+      }
+      if (length > maxBodyLen_) {
+        return fail("message is too long");
+      }
+      buf.retrieve(kTextHeaderLen);
+      header_.length = static_cast<uint32_t>(length);
+      return Status::FRAME;
+    }
+
+    // 从上次扫描结束的位置继续找'\n', 已扫描过的字节不再重复扫描
+    // 只扫描header的长度上限以内的字节, 流水线中之后的帧留给之后的decode
+    const char* begin = buf.peek();
+    size_t limit = std::min(readable, kMaxTextHeaderLen + 2);
+    const char* lf = nullptr;
+    if (limit > scanned_) {
+      lf = findByte(begin + scanned_, begin + limit, '\n');
+    }
+    if (lf == nullptr) {
+      scanned_ = limit;
+      if (readable > kMaxTextHeaderLen + 1) {
+        return fail("invalid message header");
+      }
+      return Status::INCOMPLETE;
+    }
+    if (lf == begin || lf[-1] != '\r') {
+      return fail("invalid message header");
+    }
+
+    const char* end = lf - 1;  // '\r'
+    size_t headerLen = static_cast<size_t>(lf + 1 - begin);
+    scanned_ = 0;
+
+    if (end == begin) {  // 空消息, 跳过
+      buf.retrieve(headerLen);
+      continue;
+    }
+
+    if (!parseTextLength(begin, end, &length) || length == 0) {
+      return fail("invalid message header");
+    }
+    if (length > maxBodyLen_) {
+      return fail("message is too long");
+    }
+
+    buf.retrieve(headerLen);
+    header_.length = static_cast<uint32_t>(length);
+    return Status::FRAME;
+  }
+}
+
+FrameDecoder::Status FrameDecoder::decodeBinaryHeader(Buffer& buf) {
+  if (buf.readableBytes() < kFrameHeaderLen) return Status::INCOMPLETE;
+  if (!isBinaryFrame(buf.peek())) {
+    return fail("invalid message header");
+  }
+
+  auto header = decodeFrameHeader(buf.peek());
+  if (header.flags != 0 || !isKnownCodec(header.codec)) {
+    return fail("unsupported frame flags or codec");
+  }
+  if (!codecChosen_) {
+    setCodec(header.codec);
+  } else if (header.codec != codec_) {
+    return fail("frame codec differs from connection codec");
+  }
+  if (header.length == 0) {
+    return fail("invalid message header");
+  }
+  if (header.length > maxBodyLen_) {
+    return fail("message is too long");
+  }
+
+  buf.retrieve(kFrameHeaderLen);
+  header_ = header;
+  return Status::FRAME;
+}
+
+/* request line + header字段 + "\r\n", 只接受POST
+body长度由Content-Length或Transfer-Encoding: chunked给出, 两者同时出现视为非法,
+避免与前面的代理对body边界的理解不一致
+*/
+FrameDecoder::Status FrameDecoder::decodeHttpHeader(Buffer& buf) {
+  size_t readable = buf.readableBytes();
+  const char* begin = buf.peek();
+  // 从上次扫描结束的位置继续找空行, 回退3字节, "\r\n\r\n"可能跨越两次到达的数据
+  size_t from = scanned_ >= 3 ? scanned_ - 3 : 0;
+  const char* end = nullptr;
+  if (readable > from) {
+    end = static_cast<const char*>(
+        memmem(begin + from, readable - from, "\r\n\r\n", 4));
+  }
+  if (end == nullptr) {
+    scanned_ = readable;
+    if (scanned_ > kMaxHttpHeaderLen) {
+      return fail("http header is too long");
+    }
+    return Status::INCOMPLETE;
+  }
+  scanned_ = 0;
+
+  size_t headerLen = static_cast<size_t>(end + 4 - begin);
+  if (headerLen > kMaxHttpHeaderLen) {
+    return fail("http header is too long");
+  }
+
+  // 每一行都以"\r\n"结尾, 最后的空行不在head中
+  std::string_view head(begin, static_cast<size_t>(end + 2 - begin));
+  size_t lineEnd = head.find("\r\n");
+  std::string_view requestLine = head.substr(0, lineEnd);
+  head.remove_prefix(lineEnd + 2);
+
+  // METHOD SP request-target SP HTTP-version
+  auto methodEnd = requestLine.find(' ');
+  auto versionBegin = requestLine.rfind(' ');
+  if (methodEnd == std::string_view::npos || methodEnd == versionBegin) {
+    return fail("invalid http request line");
+  }
+  if (requestLine.substr(0, methodEnd) != "POST") {
+    return fail("only POST is supported");
+  }
+  auto version = requestLine.substr(versionBegin + 1);
+  if (version == "HTTP/1.1") {
+    keepAlive_ = true;
+  } else if (version == "HTTP/1.0") {
+    keepAlive_ = false;
+  } else {
+    return fail("unsupported http version");
+  }
+
+  bool hasLength = false;
+  bool chunked = false;
+  uint64_t length = 0;
+  while (!head.empty()) {
+    lineEnd = head.find("\r\n");
+    std::string_view line = head.substr(0, lineEnd);
+    head.remove_prefix(lineEnd + 2);
+
+    auto colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+      return fail("invalid http header");
+    }
+    auto name = line.substr(0, colon);
+    auto value = trim(line.substr(colon + 1));
+
+    if (equalsIgnoreCase(name, "Content-Length")) {
+      uint64_t n = 0;
+      for (char c : value) {
+        if (c < '0' || c > '9' || n > maxBodyLen_) {
+          return fail("invalid content-length");
+        }
+        n = n * 10 + static_cast<uint64_t>(c - '0');
+      }
+      if (value.empty() || (hasLength && n != length)) {
+        return fail("invalid content-length");
+      }
+      hasLength = true;
+      length = n;
+    } else if (equalsIgnoreCase(name, "Transfer-Encoding")) {
+      if (!equalsIgnoreCase(lastToken(value), "chunked")) {
+        return fail("unsupported transfer-encoding");
+      }
+      chunked = true;
+    } else if (equalsIgnoreCase(name, "Connection")) {
+      if (hasToken(value, "close")) {
+        keepAlive_ = false;
+      } else if (hasToken(value, "keep-alive")) {
+        keepAlive_ = true;
+      }
+    }
+  }
+
+  if (chunked) {
+    if (hasLength) {
+      return fail("both content-length and transfer-encoding");
+    }
+    header_.length = 0;
+    state_ = State::CHUNK_SIZE;
+  } else {
+    if (!hasLength) {
+      return fail("missing content-length");
+    }
+    if (length == 0) {
+      return fail("empty http body");
+    }
+    if (length > maxBodyLen_) {
+      return fail("message is too long");
+    }
+    header_.length = static_cast<uint32_t>(length);
+  }
+
+  buf.retrieve(headerLen);
+  return Status::FRAME;
+}
+
+/* chunk-size(十六进制) [; extension] "\r\n" + data + "\r\n", 以长度为0的chunk和trailer结束
+已解码的body始终位于buf.peek()处, 之后的skip_字节是已解析过的chunk size行和"\r\n",
+每个chunk的数据到齐后左移一次, 接在body末尾, 因此每个字节只移动一次,
+最终得到的body与Content-Length时一样是连续的, skip_在consume()时一并丢弃
+*/
+FrameDecoder::Status FrameDecoder::decodeChunkedBody(Buffer& buf) {
+  while (true) {
+    // body和待丢弃的字节之后是尚未解码的数据
+    char* body = const_cast<char*>(buf.peek());
+    char* raw = body + header_.length + skip_;
+    size_t readable = buf.readableBytes() - header_.length - skip_;
+
+    switch (state_) {
+      case State::CHUNK_SIZE: {
+        const char* lf = nullptr;
+        if (readable > scanned_) {
+          lf = findByte(raw + scanned_, raw + readable, '\n');
+        }
+        if (lf == nullptr) {
+          scanned_ = readable;
+          if (scanned_ > kMaxChunkLineLen) {
+            return fail("invalid chunk size");
+          }
+          return Status::INCOMPLETE;
+        }
+        if (lf == raw || lf[-1] != '\r') {
+          return fail("invalid chunk size");
+        }
+        scanned_ = 0;
+
+        uint64_t size = 0;
+        const char* p = raw;
+        for (; p < lf - 1 && hexValue(*p) >= 0 && size <= maxBodyLen_; ++p) {
+          size = size * 16 + static_cast<uint64_t>(hexValue(*p));
+        }
+        if (p == raw || (p < lf - 1 && *p != ';' && *p != ' ' && *p != '\t')) {
+          return fail("invalid chunk size");
+        }
+        if (header_.length + size > maxBodyLen_) {
+          return fail("message is too long");
+        }
+
+        skip_ += static_cast<size_t>(lf + 1 - raw);
+        if (size == 0) {
+          state_ = State::TRAILER;
+          break;
+        }
+        if (++chunks_ > kMaxChunks) {
+          return fail("too many chunks");
+        }
+        chunkLen_ = static_cast<size_t>(size);
+        state_ = State::CHUNK_DATA;
+        break;
+      }
+
+      case State::CHUNK_DATA:
+        if (readable < chunkLen_ + 2) return Status::INCOMPLETE;
+        if (raw[chunkLen_] != '\r' || raw[chunkLen_ + 1] != '\n') {
+          return fail("invalid chunk data");
+        }
+        // 数据左移到body末尾, 原来的位置连同末尾的"\r\n"成为待丢弃的字节
+        memmove(body + header_.length, raw, chunkLen_);
+        header_.length += static_cast<uint32_t>(chunkLen_);
+        skip_ += 2;
+        state_ = State::CHUNK_SIZE;
+        break;
+
+      case State::TRAILER: {
+        // 没有trailer时只剩一个空行, 否则找到trailer之后的空行
+        std::string_view rest(raw, readable);
+        size_t trailerLen;
+        if (rest.substr(0, 2) == "\r\n") {
+          trailerLen = 2;
+        } else {
+          auto pos = rest.find("\r\n\r\n");
+          if (pos == std::string_view::npos) {
+            if (rest.size() > kMaxHttpHeaderLen) {
+              return fail("http trailer is too long");
+            }
+            return Status::INCOMPLETE;
+          }
+          trailerLen = pos + 4;
+        }
+        if (header_.length == 0) {
+          return fail("empty http body");
+        }
+        skip_ += trailerLen;
+        state_ = State::BODY;
+        return Status::FRAME;
+      }
+
+      default:
+        assert(false);
+        return fail("invalid decoder state");
+    }
+  }
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "utils/Frame.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+// 可恢复的拆包状态机, 每个连接一个
+// 一帧数据可能分多次到达, 已解析的header和已扫描过的字节都会被记住,
+// 下次onMessage时从上次停下的位置继续, 不会重复扫描或解析
+class FrameDecoder : noncopyable {
+ public:
+  enum class Status {
+    INCOMPLETE,  // 数据不足一帧, 等待下次onMessage
+    FRAME,       // 得到完整的一帧, body位于buf.peek()处, chunked body也已拼接为连续的一段
+    ERROR,       // 格式错误, 连接应当关闭
+  };
+
+  // mode为UNKNOWN时根据第一帧的首字节判断分帧方式
+  explicit FrameDecoder(size_t maxBodyLen,
+                        FramingMode mode = FramingMode::UNKNOWN)
+      : maxBodyLen_(maxBodyLen), mode_(mode) {}
+
+  Status decode(Buffer& buf);
+
+  // 以下接口仅在decode()返回FRAME之后使用
+  // body在buf中的视图, consume()之前一直有效
+  std::string_view body(const Buffer& buf) const {
+    return std::string_view(buf.peek(), header_.length);
+  }
+  const FrameHeader& header() const { return header_; }
+  // HTTP: 回复该request之后是否保持连接
+  bool keepAlive() const { return keepAlive_; }
+  // body的编码方式, 由第一个BINARY帧确定, 之后的帧必须相同, 其余分帧方式为JSON
+  CodecId codec() const { return codec_; }
+  // consume()将从buf中取走的字节数, 即该帧在buf.peek()之后的部分
+  size_t frameBytes() const { return header_.length + skip_; }
+  // 从buf中取走body, 开始解析下一帧
+  void consume(Buffer& buf);
+
+  // 丢弃解析进度, 分帧方式保持不变
+  void reset() {
+    state_ = State::HEADER;
+    header_ = FrameHeader();
+    scanned_ = 0;
+    keepAlive_ = true;
+    chunkLen_ = 0;
+    chunks_ = 0;
+    skip_ = 0;
+  }
+
+  FramingMode mode() const { return mode_; }
+  void setMode(FramingMode mode) { mode_ = mode; }
+  // 客户端预先确定编码方式, 对端回复的帧必须与之相同
+  void setCodec(CodecId codec) {
+    codec_ = codec;
+    codecChosen_ = true;
+  }
+
+  // decode()返回ERROR时的错误描述
+  const char* error() const { return error_; }
+
+ private:
+  enum class State {
+    HEADER,
+    CHUNK_SIZE,  // HTTP chunked body, 以下三个状态中header_.length为已拼接的body长度
+    CHUNK_DATA,
+    TRAILER,
+    BODY,
+  };
+
+  Status decodeTextHeader(Buffer& buf);
+  Status decodeBinaryHeader(Buffer& buf);
+  Status decodeHttpHeader(Buffer& buf);
+  Status decodeChunkedBody(Buffer& buf);
+  Status fail(const char* error) {
+    error_ = error;
+    return Status::ERROR;
+  }
+
+  const size_t maxBodyLen_;
+  FramingMode mode_;
+  CodecId codec_ = CodecId::JSON;
+  bool codecChosen_ = false;
+  State state_ = State::HEADER;
+  FrameHeader header_;
+  size_t scanned_ = 0;  // 文本header中已扫描过且不含crlf的字节数
+  bool keepAlive_ = true;
+  size_t chunkLen_ = 0;  // 当前chunk的长度
+  size_t chunks_ = 0;    // 已解析的chunk数量
+  // 紧跟在body之后、consume()时一并丢弃的字节(chunk size行、chunk末尾的"\r\n"和trailer)
+  size_t skip_ = 0;
+  const char* error_ = nullptr;
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "goa-json/include/Value.hpp"
+#include "goa-json/include/Writer.hpp"
+#include "utils/Codec.hpp"
+#include "utils/Frame.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+namespace detail {
+
+// 先在buf中为header预留位置, writeBody写完body后长度已知, 再回填header
+template <typename WriteBody>
+void appendFrameWith(Buffer& buf, FramingMode mode, CodecId codec,
+                     WriteBody&& writeBody) {
+  assert(mode == FramingMode::BINARY || codec == CodecId::JSON);
+  size_t headerLen =
+      mode == FramingMode::BINARY ? kFrameHeaderLen : kTextHeaderLen;
+  size_t headerPos = buf.readableBytes();
+  buf.ensureWritableBytes(headerLen);
+  buf.hasWritten(headerLen);
+
+  writeBody();
+  if (mode != FramingMode::BINARY) buf.append("\r\n", 2);
+
+  // buf可能在写body时扩容, 因此写完后再定位header
+  size_t bodyLen = buf.readableBytes() - headerPos - headerLen;
+  char* header = buf.beginWrite() - bodyLen - headerLen;
+
+  if (mode == FramingMode::BINARY) {
+    FrameHeader frameHeader;
+    frameHeader.length = static_cast<uint32_t>(bodyLen);
+    frameHeader.codec = codec;
+    encodeFrameHeader(header, frameHeader);
+  } else {
+    char* p = header + kTextHeaderDigits;
+    p[0] = '\r';
+    p[1] = '\n';
+    size_t n = bodyLen;  // 包含body末尾的"\r\n"
+    do {
+      *--p = static_cast<char>('0' + n % 10);
+      n /= 10;
+    } while (n != 0 && p != header);
+    while (p != header) *--p = ' ';
+  }
+}
+
+}  // namespace detail
+
+/* 把value以codec编码为一帧追加到buf末尾, 只有一次序列化, 没有中间string
+只有BINARY分帧可以使用JSON以外的编码方式
+*/
+inline void appendFrame(Buffer& buf, FramingMode mode, CodecId codec,
+                        const json::Value& value) {
+  detail::appendFrameWith(buf, mode, codec,
+                          [&]() { writeBody(buf, codec, value); });
+}
+
+// result和batch形式直接写出外层结构; 已经序列化好的body(typed codec)直接拷贝, 此时编码方式一定为JSON
+inline void appendFrame(Buffer& buf, FramingMode mode, CodecId codec,
+                        const RpcResponse& response) {
+  if (response.hasValue()) {
+    appendFrame(buf, mode, codec, response.value());
+    return;
+  }
+  if (response.hasResult()) {
+    detail::appendFrameWith(buf, mode, codec, [&]() {
+      writeResultBody(buf, codec, response.id(), response.result());
+    });
+    return;
+  }
+  if (response.hasBatch()) {
+    detail::appendFrameWith(buf, mode, codec, [&]() {
+      writeBatchBody(buf, codec, response.batch(), response.batchSize());
+    });
+    return;
+  }
+  assert(codec == CodecId::JSON);
+  detail::appendFrameWith(buf, mode, codec, [&]() {
+    buf.append(response.body().data(), response.body().size());
+  });
+}
+
+/* 把一个HTTP response追加到buf末尾, body为nullptr时没有body
+与appendFrame一样先预留Content-Length的值, body写完后回填, 值左侧补空格,
+header字段值前的空白字符是合法的
+*/
+inline void appendHttpResponse(Buffer& buf, HttpStatus status,
+                               const RpcResponse* body, bool keepAlive) {
+  BufferWriteStream os(buf);
+  switch (status) {
+    case HttpStatus::OK:
+      os.put("HTTP/1.1 200 OK\r\n");
+      break;
+    case HttpStatus::NO_CONTENT:
+      os.put("HTTP/1.1 204 No Content\r\n");
+      break;
+    case HttpStatus::BAD_REQUEST:
+      os.put("HTTP/1.1 400 Bad Request\r\n");
+      break;
+  }
+  if (!keepAlive) os.put("Connection: close\r\n");
+  if (body == nullptr) {
+    os.put("\r\n");
+    return;
+  }
+
+  os.put("Content-Type: application/json\r\nContent-Length: ");
+  size_t lengthPos = buf.readableBytes();
+  buf.ensureWritableBytes(kTextHeaderDigits);
+  buf.hasWritten(kTextHeaderDigits);
+  os.put("\r\n\r\n");
+
+  size_t bodyPos = buf.readableBytes();
+  if (body->hasValue()) {
+    json::Writer writer(os);
+    body->value().writeTo(writer);
+  } else if (body->hasResult()) {
+    writeResultBody(buf, CodecId::JSON, body->id(), body->result());
+  } else if (body->hasBatch()) {
+    writeBatchBody(buf, CodecId::JSON, body->batch(), body->batchSize());
+  } else {
+    os.put(body->body());
+  }
+
+  size_t bodyLen = buf.readableBytes() - bodyPos;
+  char* end = buf.beginWrite() - (buf.readableBytes() - lengthPos) +
+              kTextHeaderDigits;
+  char* p = end;
+  size_t n = bodyLen;
+  do {
+    *--p = static_cast<char>('0' + n % 10);
+    n /= 10;
+  } while (n != 0 && p != end - kTextHeaderDigits);
+  while (p != end - kTextHeaderDigits) *--p = ' ';
+}
+
+}  // namespace rpc
+
+}  // namespace goa
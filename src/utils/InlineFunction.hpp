@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace goa {
+
+namespace rpc {
+
+/* 与std::function用法相同的可复制回调, callable不超过kCapacity字节时保存在对象内部
+std::function只能内联保存可平凡复制且不超过两个指针的callable, 捕获了shared_ptr的lambda
+每次构造和复制都要分配内存; InlineFunction的复制只是在内部复制callable(例如增加引用计数)
+超过kCapacity的callable退回堆上分配, 行为不变
+*/
+template <typename Signature, size_t kCapacity = 32>
+class InlineFunction;
+
+template <typename R, typename... Args, size_t kCapacity>
+class InlineFunction<R(Args...), kCapacity> {
+ public:
+  InlineFunction() = default;
+  InlineFunction(std::nullptr_t) {}
+
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<
+                            std::decay_t<F>, InlineFunction>>>
+  InlineFunction(F&& func) {
+    using Functor = std::decay_t<F>;
+    if constexpr (kInline<Functor>) {
+      new (storage_) Functor(std::forward<F>(func));
+    } else {
+      *reinterpret_cast<Functor**>(storage_) =
+          new Functor(std::forward<F>(func));
+    }
+    ops_ = &kOps<Functor>;
+  }
+
+  InlineFunction(const InlineFunction& rhs) : ops_(rhs.ops_) {
+    if (ops_ != nullptr) ops_->copy(storage_, rhs.storage_);
+  }
+
+  InlineFunction(InlineFunction&& rhs) noexcept : ops_(rhs.ops_) {
+    if (ops_ != nullptr) {
+      ops_->move(storage_, rhs.storage_);
+      rhs.ops_ = nullptr;
+    }
+  }
+
+  // 按值传参, 同时用于复制和移动赋值
+  InlineFunction& operator=(InlineFunction rhs) noexcept {
+    reset();
+    if (rhs.ops_ != nullptr) {
+      rhs.ops_->move(storage_, rhs.storage_);
+      ops_ = rhs.ops_;
+      rhs.ops_ = nullptr;
+    }
+    return *this;
+  }
+
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  R operator()(Args... args) const {
+    assert(ops_ != nullptr);
+    return ops_->invoke(storage_, std::forward<Args>(args)...);
+  }
+
+ private:
+  struct Ops {
+    R (*invoke)(void* self, Args&&... args);
+    void (*copy)(void* dst, const void* src);
+    void (*move)(void* dst, void* src);  // 之后src被析构
+    void (*destroy)(void* self);
+  };
+
+  template <typename Functor>
+  static constexpr bool kInline =
+      sizeof(Functor) <= kCapacity &&
+      alignof(Functor) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<Functor>;
+
+  template <typename Functor>
+  static Functor& get(void* self) {
+    if constexpr (kInline<Functor>) {
+      return *std::launder(reinterpret_cast<Functor*>(self));
+    } else {
+      return **reinterpret_cast<Functor**>(self);
+    }
+  }
+
+  template <typename Functor>
+  static constexpr Ops kOps = {
+      [](void* self, Args&&... args) -> R {
+        return get<Functor>(self)(std::forward<Args>(args)...);
+      },
+      [](void* dst, const void* src) {
+        auto& functor = get<Functor>(const_cast<void*>(src));
+        if constexpr (kInline<Functor>) {
+          new (dst) Functor(functor);
+        } else {
+          *reinterpret_cast<Functor**>(dst) = new Functor(functor);
+        }
+      },
+      [](void* dst, void* src) {
+        if constexpr (kInline<Functor>) {
+          auto& functor = get<Functor>(src);
+          new (dst) Functor(std::move(functor));
+          functor.~Functor();
+        } else {
+          // 堆上的callable只需转移指针
+          *reinterpret_cast<Functor**>(dst) = *reinterpret_cast<Functor**>(src);
+        }
+      },
+      [](void* self) {
+        if constexpr (kInline<Functor>) {
+          get<Functor>(self).~Functor();
+        } else {
+          delete *reinterpret_cast<Functor**>(self);
+        }
+      },
+  };
+
+  void reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  static_assert(kCapacity >= sizeof(void*), "capacity too small");
+
+  const Ops* ops_ = nullptr;
+  // operator()与std::function一样为const, 但callable本身可以修改自己的状态
+  alignas(std::max_align_t) mutable unsigned char storage_[kCapacity];
+};
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,376 @@
+#include "utils/JsonCursor.hpp"
+
+#include <charconv>
+#include <cstring>
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 与MsgPack相同的嵌套深度上限
+constexpr int kJsonMaxDepth = 512;
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseHex4(const char* p, unsigned& value) {
+  value = 0;
+  for (int i = 0; i < 4; i++) {
+    int h = hexValue(p[i]);
+    if (h < 0) return false;
+    value = value << 4 | static_cast<unsigned>(h);
+  }
+  return true;
+}
+
+void appendUtf8(std::string& str, unsigned u) {
+  if (u <= 0x7f) {
+    str.push_back(static_cast<char>(u));
+  } else if (u <= 0x7ff) {
+    str.push_back(static_cast<char>(0xc0 | (u >> 6)));
+    str.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+  } else if (u <= 0xffff) {
+    str.push_back(static_cast<char>(0xe0 | (u >> 12)));
+    str.push_back(static_cast<char>(0x80 | ((u >> 6) & 0x3f)));
+    str.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+  } else {
+    str.push_back(static_cast<char>(0xf0 | (u >> 18)));
+    str.push_back(static_cast<char>(0x80 | ((u >> 12) & 0x3f)));
+    str.push_back(static_cast<char>(0x80 | ((u >> 6) & 0x3f)));
+    str.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+  }
+}
+
+// token已经过scanString的检查, 只需要还原转义字符
+bool unescape(std::string_view token, std::string& value) {
+  value.clear();
+  value.reserve(token.size());
+  const char* p = token.data();
+  const char* end = p + token.size();
+  while (p != end) {
+    char c = *p++;
+    if (c != '\\') {
+      value.push_back(c);
+      continue;
+    }
+    switch (*p++) {
+      case '"':
+        value.push_back('"');
+        break;
+      case '\\':
+        value.push_back('\\');
+        break;
+      case '/':
+        value.push_back('/');
+        break;
+      case 'b':
+        value.push_back('\b');
+        break;
+      case 'f':
+        value.push_back('\f');
+        break;
+      case 'n':
+        value.push_back('\n');
+        break;
+      case 'r':
+        value.push_back('\r');
+        break;
+      case 't':
+        value.push_back('\t');
+        break;
+      case 'u': {
+        unsigned u;
+        if (end - p < 4 || !parseHex4(p, u)) return false;
+        p += 4;
+        // 代理对
+        if (u >= 0xd800 && u <= 0xdbff) {
+          unsigned low;
+          if (end - p < 6 || p[0] != '\\' || p[1] != 'u' ||
+              !parseHex4(p + 2, low) || low < 0xdc00 || low > 0xdfff) {
+            return false;
+          }
+          p += 6;
+          u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+        } else if (u >= 0xdc00 && u <= 0xdfff) {
+          return false;
+        }
+        appendUtf8(value, u);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+}  // anonymous namespace
+
+void JsonCursor::skipWhitespace() {
+  while (p_ != end_ &&
+         (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+    p_++;
+  }
+}
+
+bool JsonCursor::atEnd() {
+  skipWhitespace();
+  return p_ == end_;
+}
+
+bool JsonCursor::consume(char c) {
+  skipWhitespace();
+  if (p_ == end_ || *p_ != c) return false;
+  p_++;
+  return true;
+}
+
+bool JsonCursor::consumeLiteral(std::string_view literal) {
+  if (static_cast<size_t>(end_ - p_) < literal.size() ||
+      memcmp(p_, literal.data(), literal.size()) != 0) {
+    return fail();
+  }
+  p_ += literal.size();
+  return true;
+}
+
+json::ValueType JsonCursor::peekType() {
+  skipWhitespace();
+  if (failed_ || p_ == end_) {
+    fail();
+    return json::ValueType::TYPE_NULL;
+  }
+  switch (*p_) {
+    case 'n':
+      return json::ValueType::TYPE_NULL;
+    case 't':
+    case 'f':
+      return json::ValueType::TYPE_BOOL;
+    case '"':
+      return json::ValueType::TYPE_STRING;
+    case '[':
+      return json::ValueType::TYPE_ARRAY;
+    case '{':
+      return json::ValueType::TYPE_OBJECT;
+    default: {
+      const char* start = p_;
+      std::string_view token;
+      auto type = scanNumber(token);
+      p_ = start;
+      if (type == json::ValueType::TYPE_NULL) fail();
+      return type;
+    }
+  }
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+json::ValueType JsonCursor::scanNumber(std::string_view& token) {
+  const char* start = p_;
+  const char* p = p_;
+  bool integer = true;
+  if (p != end_ && *p == '-') p++;
+  if (p == end_ || !isDigit(*p)) return json::ValueType::TYPE_NULL;
+  if (*p == '0') {
+    p++;
+  } else {
+    while (p != end_ && isDigit(*p)) p++;
+  }
+  if (p != end_ && *p == '.') {
+    integer = false;
+    p++;
+    if (p == end_ || !isDigit(*p)) return json::ValueType::TYPE_NULL;
+    while (p != end_ && isDigit(*p)) p++;
+  }
+  if (p != end_ && (*p == 'e' || *p == 'E')) {
+    integer = false;
+    p++;
+    if (p != end_ && (*p == '+' || *p == '-')) p++;
+    if (p == end_ || !isDigit(*p)) return json::ValueType::TYPE_NULL;
+    while (p != end_ && isDigit(*p)) p++;
+  }
+  token = std::string_view(start, static_cast<size_t>(p - start));
+  p_ = p;
+
+  if (integer) {
+    int64_t value;
+    auto result = std::from_chars(token.data(), token.data() + token.size(),
+                                  value);
+    if (result.ec == std::errc()) {
+      return value >= INT32_MIN && value <= INT32_MAX
+                 ? json::ValueType::TYPE_INT32
+                 : json::ValueType::TYPE_INT64;
+    }
+  }
+  return json::ValueType::TYPE_DOUBLE;
+}
+
+bool JsonCursor::scanString(std::string_view& token, bool& escaped) {
+  // 调用者已确认当前为'"'
+  const char* start = ++p_;
+  escaped = false;
+  while (p_ != end_) {
+    char c = *p_;
+    if (c == '"') {
+      token = std::string_view(start, static_cast<size_t>(p_ - start));
+      p_++;
+      return true;
+    }
+    if (static_cast<unsigned char>(c) < 0x20) return fail();
+    if (c == '\\') {
+      escaped = true;
+      if (++p_ == end_) return fail();
+    }
+    p_++;
+  }
+  return fail();
+}
+
+bool JsonCursor::readNull() {
+  if (peekType() != json::ValueType::TYPE_NULL) return fail();
+  return consumeLiteral("null");
+}
+
+bool JsonCursor::readBool(bool& value) {
+  if (peekType() != json::ValueType::TYPE_BOOL) return fail();
+  value = *p_ == 't';
+  return consumeLiteral(value ? "true" : "false");
+}
+
+bool JsonCursor::readInt32(int32_t& value) {
+  if (peekType() != json::ValueType::TYPE_INT32) return fail();
+  std::string_view token;
+  scanNumber(token);
+  std::from_chars(token.data(), token.data() + token.size(), value);
+  return true;
+}
+
+bool JsonCursor::readInt64(int64_t& value) {
+  if (peekType() != json::ValueType::TYPE_INT64) return fail();
+  std::string_view token;
+  scanNumber(token);
+  std::from_chars(token.data(), token.data() + token.size(), value);
+  return true;
+}
+
+bool JsonCursor::readDouble(double& value) {
+  if (peekType() != json::ValueType::TYPE_DOUBLE) return fail();
+  std::string_view token;
+  scanNumber(token);
+  auto result =
+      std::from_chars(token.data(), token.data() + token.size(), value);
+  // 超出double范围的数值交给json::Value的路径处理
+  if (result.ec != std::errc()) return fail();
+  return true;
+}
+
+bool JsonCursor::readString(std::string& value) {
+  if (peekType() != json::ValueType::TYPE_STRING) return fail();
+  std::string_view token;
+  bool escaped;
+  if (!scanString(token, escaped)) return false;
+  if (!escaped) {
+    value.assign(token.data(), token.size());
+    return true;
+  }
+  return unescape(token, value) || fail();
+}
+
+bool JsonCursor::readStringView(std::string_view& value) {
+  if (peekType() != json::ValueType::TYPE_STRING) return fail();
+  bool escaped;
+  if (!scanString(value, escaped)) return false;
+  return !escaped || fail();
+}
+
+bool JsonCursor::skipValue() { return skipValue(0); }
+
+bool JsonCursor::skipValue(std::string_view& raw) {
+  skipWhitespace();
+  const char* start = p_;
+  if (!skipValue(0)) return false;
+  raw = std::string_view(start, static_cast<size_t>(p_ - start));
+  return true;
+}
+
+bool JsonCursor::skipValue(int depth) {
+  if (depth > kJsonMaxDepth) return fail();
+  switch (peekType()) {
+    case json::ValueType::TYPE_NULL:
+      return !failed_ && consumeLiteral("null");
+    case json::ValueType::TYPE_BOOL:
+      return consumeLiteral(*p_ == 't' ? "true" : "false");
+    case json::ValueType::TYPE_STRING: {
+      std::string_view token;
+      bool escaped;
+      return scanString(token, escaped);
+    }
+    case json::ValueType::TYPE_ARRAY:
+      startArray();
+      while (nextElement()) {
+        if (!skipValue(depth + 1)) return false;
+      }
+      return !failed_;
+    case json::ValueType::TYPE_OBJECT: {
+      startObject();
+      std::string_view key;
+      while (nextMember(key)) {
+        if (!skipValue(depth + 1)) return false;
+      }
+      return !failed_;
+    }
+    default: {
+      std::string_view token;
+      scanNumber(token);
+      return true;
+    }
+  }
+}
+
+bool JsonCursor::startObject() {
+  if (failed_ || !consume('{')) return fail();
+  first_ = true;
+  return true;
+}
+
+bool JsonCursor::nextMember(std::string_view& key) {
+  if (failed_) return false;
+  if (consume('}')) {
+    first_ = false;  // 同nextElement
+    return false;
+  }
+  if (!first_ && !consume(',')) return fail();
+  first_ = false;
+  if (!readStringView(key)) return false;
+  if (!consume(':')) return fail();
+  return true;
+}
+
+bool JsonCursor::startArray() {
+  if (failed_ || !consume('[')) return fail();
+  first_ = true;
+  return true;
+}
+
+bool JsonCursor::nextElement() {
+  if (failed_) return false;
+  if (consume(']')) {
+    // 嵌套的容器结束后, 外层容器中的下一个元素不是第一个
+    first_ = false;
+    return false;
+  }
+  if (!first_ && !consume(',')) return fail();
+  first_ = false;
+  return true;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
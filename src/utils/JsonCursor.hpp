@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "goa-json/include/Value.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* JSON的拉取式读取器, 直接在原始数据上按顺序读出各个值, 不构造json::Value
+用于typed codec: 由stub生成器按spec.json为每个method生成参数的读取代码, 见readTypedParams
+数值的类型判断与json::Document一致: 没有小数和指数部分的整数在int32范围内为INT32,
+在int64范围内为INT64, 其余为DOUBLE. readXXX只接受对应类型的值, 因此与json::Value路径的参数校验结果相同
+任何读取失败后cursor进入失败状态, 之后的读取都返回false, 由调用者退回json::Value的路径
+*/
+class JsonCursor : noncopyable {
+ public:
+  explicit JsonCursor(std::string_view json)
+      : p_(json.data()), end_(json.data() + json.size()) {}
+
+  bool failed() const { return failed_; }
+  // 之后只剩空白字符
+  bool atEnd();
+
+  // 下一个值的类型, 不移动位置, 数据非法时返回TYPE_NULL并进入失败状态
+  json::ValueType peekType();
+
+  bool readNull();
+  bool readBool(bool& value);
+  bool readInt32(int32_t& value);
+  bool readInt64(int64_t& value);
+  bool readDouble(double& value);
+  // 处理转义字符
+  bool readString(std::string& value);
+  // 只接受不含转义字符的string, value指向原始数据
+  bool readStringView(std::string_view& value);
+  // 跳过一个任意类型的值, raw为该值的原始文本
+  bool skipValue();
+  bool skipValue(std::string_view& raw);
+
+  /* object和array的遍历:
+    if (!cursor.startObject()) ...
+    while (cursor.nextMember(key)) { 读取value }
+    if (cursor.failed()) ...
+  key只接受不含转义字符的string
+  */
+  bool startObject();
+  bool nextMember(std::string_view& key);
+  bool startArray();
+  bool nextElement();
+
+ private:
+  bool fail() {
+    failed_ = true;
+    return false;
+  }
+
+  void skipWhitespace();
+  bool consume(char c);
+  bool consumeLiteral(std::string_view literal);
+  // 扫描一个number, 返回其类型, 非法时返回TYPE_NULL
+  json::ValueType scanNumber(std::string_view& token);
+  // 扫描一个string, token不含引号, escaped表示其中有转义字符
+  bool scanString(std::string_view& token, bool& escaped);
+  bool skipValue(int depth);
+
+  const char* p_;
+  const char* end_;
+  bool failed_ = false;
+  // nextMember/nextElement是否为容器中的第一个
+  bool first_ = false;
+};
+
+// 读取一个typed codec支持的参数类型
+inline bool readTypedParam(JsonCursor& cursor, bool& value) {
+  return cursor.readBool(value);
+}
+inline bool readTypedParam(JsonCursor& cursor, int32_t& value) {
+  return cursor.readInt32(value);
+}
+inline bool readTypedParam(JsonCursor& cursor, int64_t& value) {
+  return cursor.readInt64(value);
+}
+inline bool readTypedParam(JsonCursor& cursor, double& value) {
+  return cursor.readDouble(value);
+}
+inline bool readTypedParam(JsonCursor& cursor, std::string& value) {
+  return cursor.readString(value);
+}
+
+/* 把params(request中params的原始文本)直接读入args, 不构造json::Value
+与Procedure::validateGeneric的规则相同: params为array时按位置对应, 为object时按names对应,
+个数必须相同, object中不能有多余或重复的key, 类型必须完全一致
+不符合时返回false, args的值没有意义
+*/
+template <typename... Args>
+bool readTypedParams(std::string_view params,
+                     const std::array<std::string_view, sizeof...(Args)>& names,
+                     Args&... args) {
+  constexpr size_t n = sizeof...(Args);
+  static_assert(n > 0 && n <= 64, "typed params must be in [1, 64]");
+
+  JsonCursor cursor(params);
+  switch (cursor.peekType()) {
+    case json::ValueType::TYPE_ARRAY: {
+      cursor.startArray();
+      bool ok = ((cursor.nextElement() && readTypedParam(cursor, args)) && ...);
+      return ok && !cursor.nextElement() && !cursor.failed() && cursor.atEnd();
+    }
+    case json::ValueType::TYPE_OBJECT: {
+      cursor.startObject();
+      uint64_t seen = 0;
+      std::string_view key;
+      while (cursor.nextMember(key)) {
+        size_t index = 0;
+        while (index < n && names[index] != key) index++;
+        if (index == n || (seen & (uint64_t(1) << index))) return false;
+        seen |= uint64_t(1) << index;
+
+        // 按下标读入对应的参数
+        size_t i = 0;
+        bool ok = ((i++ == index && readTypedParam(cursor, args)) || ...);
+        if (!ok) return false;
+      }
+      uint64_t all = n == 64 ? ~uint64_t(0) : (uint64_t(1) << n) - 1;
+      return seen == all && !cursor.failed() && cursor.atEnd();
+    }
+    default:
+      return false;
+  }
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,144 @@
+#include "utils/MsgPack.hpp"
+
+#include <cstring>
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 1字节tag + 大端序的值
+template <typename T>
+void putBig(Buffer& buf, uint8_t tag, T value) {
+  char data[1 + sizeof(T)];
+  data[0] = static_cast<char>(tag);
+  for (size_t i = 0; i < sizeof(T); i++) {
+    data[sizeof(T) - i] = static_cast<char>(value & 0xff);
+    value = static_cast<T>(value >> 8);
+  }
+  buf.append(data, sizeof(data));
+}
+
+void putTag(Buffer& buf, uint8_t tag) {
+  char c = static_cast<char>(tag);
+  buf.append(&c, 1);
+}
+
+void writeInteger(Buffer& buf, int64_t value) {
+  if (value >= 0) {
+    if (value <= 0x7f) {
+      putTag(buf, static_cast<uint8_t>(value));  // positive fixint
+    } else if (value <= UINT8_MAX) {
+      putBig(buf, 0xcc, static_cast<uint8_t>(value));
+    } else if (value <= UINT16_MAX) {
+      putBig(buf, 0xcd, static_cast<uint16_t>(value));
+    } else if (value <= UINT32_MAX) {
+      putBig(buf, 0xce, static_cast<uint32_t>(value));
+    } else {
+      putBig(buf, 0xcf, static_cast<uint64_t>(value));
+    }
+  } else {
+    if (value >= -32) {
+      putTag(buf, static_cast<uint8_t>(value));  // negative fixint
+    } else if (value >= INT8_MIN) {
+      putBig(buf, 0xd0, static_cast<uint8_t>(value));
+    } else if (value >= INT16_MIN) {
+      putBig(buf, 0xd1, static_cast<uint16_t>(value));
+    } else if (value >= INT32_MIN) {
+      putBig(buf, 0xd2, static_cast<uint32_t>(value));
+    } else {
+      putBig(buf, 0xd3, static_cast<uint64_t>(value));
+    }
+  }
+}
+
+void writeString(Buffer& buf, std::string_view str) {
+  size_t length = str.size();
+  if (length <= 31) {
+    putTag(buf, static_cast<uint8_t>(0xa0 | length));
+  } else if (length <= UINT8_MAX) {
+    putBig(buf, 0xd9, static_cast<uint8_t>(length));
+  } else if (length <= UINT16_MAX) {
+    putBig(buf, 0xda, static_cast<uint16_t>(length));
+  } else {
+    putBig(buf, 0xdb, static_cast<uint32_t>(length));
+  }
+  buf.append(str.data(), length);
+}
+
+// fixarray/fixmap的tag分别为0x90/0x80, 16位和32位长度的tag为array16/map16之后的一个
+void writeContainerHeader(Buffer& buf, size_t size, uint8_t fixTag,
+                          uint8_t tag16) {
+  if (size <= 15) {
+    putTag(buf, static_cast<uint8_t>(fixTag | size));
+  } else if (size <= UINT16_MAX) {
+    putBig(buf, tag16, static_cast<uint16_t>(size));
+  } else {
+    putBig(buf, static_cast<uint8_t>(tag16 + 1), static_cast<uint32_t>(size));
+  }
+}
+
+}  // anonymous namespace
+
+// 直接遍历Value而不是通过writeTo的SAX事件, 因为array和map的header需要预先知道元素个数
+void writeMsgPack(Buffer& buf, const json::Value& value) {
+  switch (value.getType()) {
+    case json::ValueType::TYPE_NULL:
+      putTag(buf, 0xc0);
+      break;
+    case json::ValueType::TYPE_BOOL:
+      putTag(buf, value.getBool() ? 0xc3 : 0xc2);
+      break;
+    case json::ValueType::TYPE_INT32:
+      writeInteger(buf, value.getInt32());
+      break;
+    case json::ValueType::TYPE_INT64:
+      writeInteger(buf, value.getInt64());
+      break;
+    case json::ValueType::TYPE_DOUBLE: {
+      double d = value.getDouble();
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      putBig(buf, 0xcb, bits);
+      break;
+    }
+    case json::ValueType::TYPE_STRING:
+      writeString(buf, value.getStringView());
+      break;
+    case json::ValueType::TYPE_ARRAY: {
+      size_t size = value.getSize();
+      writeContainerHeader(buf, size, 0x90, 0xdc);
+      for (size_t i = 0; i < size; i++) {
+        writeMsgPack(buf, value[i]);
+      }
+      break;
+    }
+    case json::ValueType::TYPE_OBJECT:
+      writeContainerHeader(buf, value.getSize(), 0x80, 0xde);
+      for (auto& member : value.getObject()) {
+        writeString(buf, member.key.getStringView());
+        writeMsgPack(buf, member.value);
+      }
+      break;
+  }
+}
+
+void writeMsgPackArrayHeader(Buffer& buf, size_t size) {
+  writeContainerHeader(buf, size, 0x90, 0xdc);
+}
+
+void writeMsgPackResult(Buffer& buf, const json::Value& id,
+                        const json::Value& result) {
+  putTag(buf, 0x83);  // fixmap, 3个成员
+  writeString(buf, "jsonrpc");
+  writeString(buf, "2.0");
+  writeString(buf, "id");
+  writeMsgPack(buf, id);
+  writeString(buf, "result");
+  writeMsgPack(buf, result);
+}
+
+}  // namespace rpc
+
+}  // namespace goa
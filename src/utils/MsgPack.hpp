@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "goa-json/include/Value.hpp"
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* json::Value与MessagePack之间的转换, 只使用与json对应的类型:
+nil bool int float str array map(key必须为str), 不支持bin和ext
+整数按值选择最短的编码, double固定为float64, 因此数值可以无损往返, 且不需要格式化和解析文本
+*/
+
+// 把value编码后追加到buf末尾
+void writeMsgPack(Buffer& buf, const json::Value& value);
+
+// array的header, 之后应当紧跟size个元素
+void writeMsgPackArrayHeader(Buffer& buf, size_t size);
+
+// 成功的response {"jsonrpc":"2.0","id":id,"result":result}, 不需要先构造外层的json::Value
+void writeMsgPackResult(Buffer& buf, const json::Value& id,
+                        const json::Value& result);
+
+// 与json::Reader相同, 以SAX事件的方式交给handler(例如json::Document)
+// data必须恰好是一个完整的对象, 成功返回nullptr, 否则返回错误描述
+template <typename Handler>
+const char* readMsgPack(std::string_view data, Handler& handler);
+
+namespace detail {
+
+// 嵌套深度上限, 防止恶意数据导致栈溢出
+constexpr int kMsgPackMaxDepth = 512;
+
+template <typename Handler>
+class MsgPackReader : noncopyable {
+ public:
+  MsgPackReader(std::string_view data, Handler& handler)
+      : p_(data.data()), end_(data.data() + data.size()), handler_(handler) {}
+
+  const char* parse() {
+    if (!parseValue(0)) return error_;
+    if (p_ != end_) return "trailing data after msgpack value";
+    return nullptr;
+  }
+
+ private:
+  bool fail(const char* error) {
+    error_ = error;
+    return false;
+  }
+
+  bool has(size_t n) const { return static_cast<size_t>(end_ - p_) >= n; }
+
+  // 大端序的无符号整数
+  template <typename T>
+  T readBig() {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+      value = static_cast<T>(value << 8 | static_cast<uint8_t>(p_[i]));
+    }
+    p_ += sizeof(T);
+    return value;
+  }
+
+  template <typename T>
+  bool readLength(size_t* length) {
+    if (!has(sizeof(T))) return fail("truncated msgpack length");
+    *length = readBig<T>();
+    return true;
+  }
+
+  bool integer(int64_t value) {
+    if (value >= INT32_MIN && value <= INT32_MAX) {
+      return handler_.Int32(static_cast<int32_t>(value));
+    }
+    return handler_.Int64(value);
+  }
+
+  bool string(size_t length) {
+    if (!has(length)) return fail("truncated msgpack string");
+    std::string_view str(p_, length);
+    p_ += length;
+    return handler_.String(str);
+  }
+
+  bool array(size_t size, int depth) {
+    if (!handler_.StartArray()) return fail("handler stopped");
+    for (size_t i = 0; i < size; i++) {
+      if (!parseValue(depth + 1)) return false;
+    }
+    return handler_.EndArray();
+  }
+
+  bool map(size_t size, int depth) {
+    if (!handler_.StartObject()) return fail("handler stopped");
+    for (size_t i = 0; i < size; i++) {
+      if (!parseKey()) return false;
+      if (!parseValue(depth + 1)) return false;
+    }
+    return handler_.EndObject();
+  }
+
+  bool parseKey() {
+    if (!has(1)) return fail("truncated msgpack map");
+    auto tag = static_cast<uint8_t>(*p_++);
+    size_t length;
+    if ((tag & 0xe0) == 0xa0) {
+      length = tag & 0x1f;
+    } else if (tag == 0xd9) {
+      if (!readLength<uint8_t>(&length)) return false;
+    } else if (tag == 0xda) {
+      if (!readLength<uint16_t>(&length)) return false;
+    } else if (tag == 0xdb) {
+      if (!readLength<uint32_t>(&length)) return false;
+    } else {
+      return fail("msgpack map key must be string");
+    }
+    if (!has(length)) return fail("truncated msgpack string");
+    std::string_view key(p_, length);
+    p_ += length;
+    return handler_.Key(key);
+  }
+
+  bool parseValue(int depth) {
+    if (depth > kMsgPackMaxDepth) return fail("msgpack nested too deep");
+    if (!has(1)) return fail("truncated msgpack value");
+    auto tag = static_cast<uint8_t>(*p_++);
+
+    if (tag <= 0x7f) return integer(tag);  // positive fixint
+    if (tag >= 0xe0) return integer(static_cast<int8_t>(tag));  // negative fixint
+    if ((tag & 0xe0) == 0xa0) return string(tag & 0x1f);
+    if ((tag & 0xf0) == 0x90) return array(tag & 0x0f, depth);
+    if ((tag & 0xf0) == 0x80) return map(tag & 0x0f, depth);
+
+    size_t length;
+    switch (tag) {
+      case 0xc0:
+        return handler_.Null();
+      case 0xc2:
+        return handler_.Bool(false);
+      case 0xc3:
+        return handler_.Bool(true);
+      case 0xca: {
+        if (!has(4)) return fail("truncated msgpack float");
+        uint32_t bits = readBig<uint32_t>();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return handler_.Double(f);
+      }
+      case 0xcb: {
+        if (!has(8)) return fail("truncated msgpack float");
+        uint64_t bits = readBig<uint64_t>();
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return handler_.Double(d);
+      }
+      case 0xcc:
+        if (!has(1)) return fail("truncated msgpack integer");
+        return integer(readBig<uint8_t>());
+      case 0xcd:
+        if (!has(2)) return fail("truncated msgpack integer");
+        return integer(readBig<uint16_t>());
+      case 0xce:
+        if (!has(4)) return fail("truncated msgpack integer");
+        return integer(readBig<uint32_t>());
+      case 0xcf: {
+        if (!has(8)) return fail("truncated msgpack integer");
+        uint64_t value = readBig<uint64_t>();
+        if (value > INT64_MAX) return fail("msgpack integer too big");
+        return integer(static_cast<int64_t>(value));
+      }
+      case 0xd0:
+        if (!has(1)) return fail("truncated msgpack integer");
+        return integer(static_cast<int8_t>(readBig<uint8_t>()));
+      case 0xd1:
+        if (!has(2)) return fail("truncated msgpack integer");
+        return integer(static_cast<int16_t>(readBig<uint16_t>()));
+      case 0xd2:
+        if (!has(4)) return fail("truncated msgpack integer");
+        return integer(static_cast<int32_t>(readBig<uint32_t>()));
+      case 0xd3:
+        if (!has(8)) return fail("truncated msgpack integer");
+        return integer(static_cast<int64_t>(readBig<uint64_t>()));
+      case 0xd9:
+        return readLength<uint8_t>(&length) && string(length);
+      case 0xda:
+        return readLength<uint16_t>(&length) && string(length);
+      case 0xdb:
+        return readLength<uint32_t>(&length) && string(length);
+      case 0xdc:
+        return readLength<uint16_t>(&length) && array(length, depth);
+      case 0xdd:
+        return readLength<uint32_t>(&length) && array(length, depth);
+      case 0xde:
+        return readLength<uint16_t>(&length) && map(length, depth);
+      case 0xdf:
+        return readLength<uint32_t>(&length) && map(length, depth);
+      default:
+        return fail("unsupported msgpack type");
+    }
+  }
+
+  const char* p_;
+  const char* const end_;
+  Handler& handler_;
+  const char* error_ = "handler stopped";
+};
+
+}  // namespace detail
+
+template <typename Handler>
+const char* readMsgPack(std::string_view data, Handler& handler) {
+  detail::MsgPackReader<Handler> reader(data, handler);
+  return reader.parse();
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 固定大小内存块的线程本地free list, 用于每个request都要创建的小对象(额度、batch结果集等)
+内存块记录所属线程的pool, 在其他线程中归还时压入所属pool的remote_栈(多生产者单消费者),
+所属线程的local_用完时一次取走整个remote_栈, 因此request在线程池中完成时内存块也能回到IO线程
+每个线程的内存块数量为该线程同时存在的对象的峰值, 之后不再分配
+*/
+template <size_t kSize>
+class BlockPool : noncopyable {
+ public:
+  static void* allocate() { return local().pop(); }
+
+  static void deallocate(void* ptr) {
+    Block* block = static_cast<Block*>(ptr) - 1;
+    BlockPool* owner = block->owner;
+    if (owner == &local()) {
+      block->next = owner->local_;
+      owner->local_ = block;
+    } else {
+      owner->pushRemote(block);
+    }
+  }
+
+ private:
+  // header之后为对象的内存, 对齐与operator new相同
+  struct alignas(std::max_align_t) Block {
+    BlockPool* owner;
+    Block* next;
+  };
+
+  // 线程退出后其他线程仍可能归还内存块, 因此pool不释放,
+  // goa-rpc中的IO线程和线程池的线程都与server的生命周期相同
+  static BlockPool& local() {
+    thread_local BlockPool* pool = new BlockPool;
+    return *pool;
+  }
+
+  void* pop() {
+    if (local_ == nullptr) {
+      local_ = remote_.exchange(nullptr, std::memory_order_acquire);
+    }
+    Block* block = local_;
+    if (block == nullptr) {
+      block = static_cast<Block*>(::operator new(sizeof(Block) + kSize));
+      block->owner = this;
+    } else {
+      local_ = block->next;
+    }
+    return block + 1;
+  }
+
+  // 只有push和取走整个栈两种操作, 没有ABA问题
+  void pushRemote(Block* block) {
+    Block* head = remote_.load(std::memory_order_relaxed);
+    do {
+      block->next = head;
+    } while (!remote_.compare_exchange_weak(head, block,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed));
+  }
+
+  Block* local_ = nullptr;
+  std::atomic<Block*> remote_{nullptr};
+};
+
+// 单个对象从BlockPool分配的allocator, 用于std::allocate_shared, 控制块与对象在同一个内存块中
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+
+  PoolAllocator() = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) {}
+
+  T* allocate(size_t n) {
+    if constexpr (kPooled) {
+      if (n == 1) return static_cast<T*>(Pool::allocate());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, size_t n) {
+    if constexpr (kPooled) {
+      if (n == 1) {
+        Pool::deallocate(ptr);
+        return;
+      }
+    }
+    ::operator delete(ptr);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const {
+    return true;
+  }
+
+ private:
+  // 按16字节向上取整, 大小相近的类型共用一个pool
+  static constexpr size_t kBlockSize = (sizeof(T) + 15) / 16 * 16;
+  static constexpr bool kPooled =
+      alignof(T) <= alignof(std::max_align_t) && kBlockSize <= 256;
+  using Pool = BlockPool<kBlockSize>;
+};
+
+// 与std::make_shared相同, 内存来自本线程的BlockPool
+template <typename T, typename... Args>
+std::shared_ptr<T> makePooled(Args&&... args) {
+  return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace rpc
+
+}  // namespace goa
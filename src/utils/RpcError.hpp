@@ -6,13 +6,14 @@ namespace goa {
 
 namespace rpc {
 
-// JSON-RPC规范错误码定义
-#define ERROR_MAP(XX)                              \
-  XX(PARSE_ERROR, -32700, "Parse error")           \
-  XX(INVALID_REQUEST, -32600, "Invalid request")   \
-  XX(METHOD_NOT_FOUND, -32601, "Method not found") \
-  XX(INVALID_PARAMS, -32602, "Invalid params")     \
-  XX(INTERNAL_ERROR, -32603, "Internal error")
+// JSON-RPC规范错误码定义, -32000到-32099为规范留给实现自定义的server error
+#define ERROR_MAP(XX)                                \
+  XX(PARSE_ERROR, -32700, "Parse error")             \
+  XX(INVALID_REQUEST, -32600, "Invalid request")     \
+  XX(METHOD_NOT_FOUND, -32601, "Method not found")   \
+  XX(INVALID_PARAMS, -32602, "Invalid params")       \
+  XX(INTERNAL_ERROR, -32603, "Internal error")       \
+  XX(DEADLINE_EXCEEDED, -32000, "Deadline exceeded")
 
 enum class ERROR {
 #define GEN_ERROR(e, c, s) RPC_##e,
@@ -44,6 +45,8 @@ class RpcError {
         return ERROR::RPC_INVALID_PARAMS;
       case -32603:
         return ERROR::RPC_INTERNAL_ERROR;
+      case -32000:
+        return ERROR::RPC_DEADLINE_EXCEEDED;
       default:
         assert(false && "bad error code");
     }
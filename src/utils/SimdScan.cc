@@ -0,0 +1,99 @@
+#include "utils/SimdScan.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GOA_RPC_SIMD_X86 1
+#endif
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+const char* findByteScalar(const char* begin, const char* end, char c) {
+  for (const char* p = begin; p < end; ++p) {
+    if (*p == c) return p;
+  }
+  return nullptr;
+}
+
+#ifdef GOA_RPC_SIMD_X86
+
+const char* findByteSse2(const char* begin, const char* end, char c) {
+  const __m128i needle = _mm_set1_epi8(c);
+  const char* p = begin;
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    if (mask != 0) return p + __builtin_ctz(mask);
+  }
+  return findByteScalar(p, end, c);
+}
+
+__attribute__((target("avx2"))) const char* findByteAvx2(const char* begin,
+                                                         const char* end,
+                                                         char c) {
+  const __m256i needle = _mm256_set1_epi8(c);
+  const char* p = begin;
+  for (; end - p >= 32; p += 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    auto mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    if (mask != 0) return p + __builtin_ctz(mask);
+  }
+  return findByteSse2(p, end, c);
+}
+
+#endif
+
+using FindByteFunc = const char* (*)(const char*, const char*, char);
+
+struct ScanImpl {
+  FindByteFunc findByte;
+  const char* name;
+};
+
+ScanImpl resolveScanImpl() {
+#ifdef GOA_RPC_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return {findByteAvx2, "avx2"};
+  return {findByteSse2, "sse2"};
+#else
+  return {findByteScalar, "scalar"};
+#endif
+}
+
+const ScanImpl& scanImpl() {
+  static const ScanImpl impl = resolveScanImpl();
+  return impl;
+}
+
+}  // anonymous namespace
+
+const char* findByte(const char* begin, const char* end, char c) {
+  return scanImpl().findByte(begin, end, c);
+}
+
+const char* simdScanImpl() { return scanImpl().name; }
+
+bool parseTextLength(const char* begin, const char* end, uint64_t* length) {
+  while (begin < end && *begin == ' ') ++begin;
+  while (end > begin && end[-1] == ' ') --end;
+  if (begin == end || end - begin > 16) return false;
+
+  uint64_t value = 0;
+  for (const char* p = begin; p < end; ++p) {
+    // 不是数字时转换为很大的无符号数
+    auto digit = static_cast<unsigned>(*p - '0');
+    if (digit > 9) return false;
+    value = value * 10 + digit;
+  }
+  *length = value;
+  return true;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "utils/Frame.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace goa {
+
+namespace rpc {
+
+/* 拆包时使用的字节扫描和整数解析
+x86上按CPU在运行时选择AVX2或SSE2(x86-64的基本指令集)实现, 其他平台为逐字节的实现
+编译选项虽然有-march=native, 编译机与运行机不一定相同, 因此不依赖编译时的宏
+*/
+
+// [begin, end)中第一个c的位置, 没有时返回nullptr, 不会读取end之后的内存
+const char* findByte(const char* begin, const char* end, char c);
+
+// 当前使用的实现, "avx2"、"sse2"或"scalar"
+const char* simdScanImpl();
+
+/* 解析变长的文本header: 可选的前导空格 + 十进制数字 + 可选的尾随空格, 不含"\r\n"
+数字最多16位(包括前导的0), 格式非法时返回false
+只用于不是定宽header的旧客户端, 数字很少, 逐字节解析比先拷贝到对齐的缓冲区再按SWAR解析更快
+*/
+bool parseTextLength(const char* begin, const char* end, uint64_t* length);
+
+namespace detail {
+
+// 8个ASCII数字(小端序, 第一个字符在最低字节)转换为整数, 每一步把相邻的两组合并
+inline uint64_t parseEightDigits(uint64_t chunk) {
+  chunk -= 0x3030303030303030ULL;
+  chunk = (chunk * 10 + (chunk >> 8)) & 0x00ff00ff00ff00ffULL;
+  chunk = (chunk * 100 + (chunk >> 16)) & 0x0000ffff0000ffffULL;
+  chunk = (chunk * 10000 + (chunk >> 32)) & 0x00000000ffffffffULL;
+  return chunk;
+}
+
+}  // namespace detail
+
+/* 定宽文本header(见kTextHeaderDigits)的快速路径, p之后至少有16字节可读
+一次16字节的比较完成格式校验, 空格与0x10按位或后即为'0', 数字直接按SWAR解析, 不需要先找'\n'
+连续的帧之间下一帧的位置取决于本帧的长度, 省去查找使这条依赖链更短
+不是定宽header或格式非法时返回false, 由调用者退回findByte + parseTextLength
+*/
+// 位于拆包的关键路径上, SSE2是x86-64的基本指令集, 不需要运行时选择, 因此内联
+inline bool parseFixedTextHeader(const char* p, uint64_t* length) {
+  static_assert(kTextHeaderDigits == 10 && kTextHeaderLen <= 16,
+                "fixed text header must fit in 16 bytes");
+#ifdef __SSE2__
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  auto spaceMask = static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' '))));
+  // 有符号比较, 高位为1的字节是负数, 不会被当作数字
+  auto digitMask = static_cast<unsigned>(_mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)),
+                    _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)))));
+  auto crlfMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+      chunk, _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\r', '\n', 0, 0, 0,
+                           0))));
+
+  // 前10字节为若干空格加至少一个数字, 空格只能在前面
+  constexpr unsigned kDigits = (1u << kTextHeaderDigits) - 1;
+  constexpr unsigned kCrlf = 3u << kTextHeaderDigits;
+  spaceMask &= kDigits;
+  digitMask &= kDigits;
+  if ((crlfMask & kCrlf) != kCrlf || (spaceMask | digitMask) != kDigits ||
+      (spaceMask & (spaceMask + 1)) != 0 || digitMask == 0) {
+    return false;
+  }
+
+  uint64_t tail;
+  memcpy(&tail, p + 2, 8);
+  tail |= 0x1010101010101010ULL;
+  auto head = static_cast<uint64_t>(
+      (static_cast<unsigned char>(p[0] | 0x10) - '0') * 10 +
+      (static_cast<unsigned char>(p[1] | 0x10) - '0'));
+  *length = head * 100000000ULL + detail::parseEightDigits(tail);
+  return true;
+#else
+  (void)p;
+  (void)length;
+  return false;
+#endif
+}
+
+}  // namespace rpc
+
+}  // namespace goa
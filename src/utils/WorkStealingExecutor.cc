@@ -0,0 +1,121 @@
+#include "utils/WorkStealingExecutor.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace goa {
+
+namespace rpc {
+
+namespace {
+
+// 当前线程所属的executor和worker序号, 不是worker时executor为nullptr
+struct CurrentWorker {
+  const WorkStealingExecutor* executor = nullptr;
+  size_t index = 0;
+};
+
+thread_local CurrentWorker currentWorker;
+
+void bindCpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (err != 0) {
+    WARN("WorkStealingExecutor bind cpu {} failed: {}", cpu, strerror(err));
+  }
+}
+
+}  // anonymous namespace
+
+WorkStealingExecutor::WorkStealingExecutor(size_t numWorkers,
+                                           const std::vector<int>& cpus) {
+  assert(numWorkers > 0);
+  workers_.reserve(numWorkers);
+  for (size_t i = 0; i < numWorkers; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  threads_.reserve(numWorkers);
+  for (size_t i = 0; i < numWorkers; i++) {
+    int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+    threads_.emplace_back([this, i, cpu]() { workerLoop(i, cpu); });
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  {
+    std::lock_guard lock(idleMutex_);
+    stopping_ = true;
+  }
+  idleCond_.notify_all();
+  for (auto& thread : threads_) thread.join();
+}
+
+void WorkStealingExecutor::runTask(Task task) {
+  size_t index = currentWorker.executor == this
+                     ? currentWorker.index
+                     : nextWorker_.fetch_add(1, std::memory_order_relaxed) %
+                           workers_.size();
+  {
+    auto& worker = *workers_[index];
+    std::lock_guard lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+
+  pending_.fetch_add(1);
+  if (idle_.load() > 0) {
+    // 持有锁时通知, worker检查完条件之后、开始等待之前不会错过
+    std::lock_guard lock(idleMutex_);
+    idleCond_.notify_one();
+  }
+}
+
+void WorkStealingExecutor::workerLoop(size_t index, int cpu) {
+  currentWorker = {this, index};
+  if (cpu >= 0) bindCpu(cpu);
+
+  while (true) {
+    Task task;
+    if (takeTask(index, task)) {
+      pending_.fetch_sub(1);
+      task();
+      continue;
+    }
+
+    std::unique_lock lock(idleMutex_);
+    // 停止时只剩其他worker正在提交到自己队列的任务, 由它们自己执行
+    if (stopping_ && pending_.load() <= 0) return;
+    idle_.fetch_add(1);
+    idleCond_.wait(lock,
+                   [this]() { return stopping_ || pending_.load() > 0; });
+    idle_.fetch_sub(1);
+  }
+}
+
+// 自己的队列取头部, 保持提交的顺序; 窃取时取尾部, 与所有者从两端访问
+bool WorkStealingExecutor::takeTask(size_t index, Task& task) {
+  size_t n = workers_.size();
+  for (size_t i = 0; i < n; i++) {
+    auto& worker = *workers_[(index + i) % n];
+    std::lock_guard lock(worker.mutex);
+    if (worker.tasks.empty()) continue;
+    if (i == 0) {
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    } else {
+      task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+}  // namespace rpc
+
+}  // namespace goa
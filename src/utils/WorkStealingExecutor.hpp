@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "utils/utils.hpp"
+
+namespace goa {
+
+namespace rpc {
+
+/* 工作窃取的线程池, 每个worker有自己的任务队列
+在worker中提交的任务放入该worker自己的队列, 其他线程提交的任务轮流放入各个worker的队列
+worker先取自己队列的头部, 为空时从其他worker队列的尾部窃取, 因此某个service的任务集中到来时
+所有worker都会参与, 不会像每个service各自的ThreadPool那样一边排队一边空闲
+每个队列有自己的锁, 只有窃取时才会与队列的所有者竞争
+*/
+class WorkStealingExecutor : noncopyable {
+ public:
+  using Task = std::function<void()>;
+
+  // cpus非空时第i个worker绑定到cpus[i % cpus.size()]
+  explicit WorkStealingExecutor(size_t numWorkers,
+                                const std::vector<int>& cpus = {});
+  // 执行完已提交的任务后退出
+  ~WorkStealingExecutor();
+
+  void runTask(Task task);
+
+  size_t numWorkers() const { return workers_.size(); }
+
+ private:
+  struct alignas(64) Worker {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void workerLoop(size_t index, int cpu);
+  bool takeTask(size_t index, Task& task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> nextWorker_{0};  // 外部提交时轮流选择的worker
+
+  // pending_与idle_都是seq_cst: 提交者先增加pending_再读idle_, worker先增加idle_再读pending_,
+  // 至少有一方能看到另一方, 因此不会丢失唤醒
+  // 先入队再计数, 任务可能在计数之前就被取走, 因此pending_可能短暂为负
+  std::atomic<long> pending_{0};  // 已提交但未被取走的任务
+  std::atomic<size_t> idle_{0};
+  std::mutex idleMutex_;
+  std::condition_variable idleCond_;
+  bool stopping_ = false;  // 由idleMutex_保护
+};
+
+}  // namespace rpc
+
+}  // namespace goa
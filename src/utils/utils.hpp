@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cassert>
+#include <memory>
+#include <string>
+#include <string_view>
+
 #include <goa-ev/src/Buffer.hpp>
 #include <goa-ev/src/Callbacks.hpp>
 #include <goa-ev/src/CountDownLatch.hpp>
@@ -12,6 +17,10 @@
 #include <goa-ev/src/ThreadPool.hpp>
 #include <goa-ev/src/Timestamp.hpp>
 #include <goa-json/include/Value.hpp>
+#include <goa-json/include/Writer.hpp>
+
+#include "utils/Deadline.hpp"
+#include "utils/InlineFunction.hpp"
 
 namespace goa {
 
@@ -25,36 +34,145 @@ using ev::ConnectionCallback;
 using ev::CountDownLatch;
 using ev::EventLoop;
 using ev::InetAddress;
+using ev::MessageCallback;
 using ev::noncopyable;
 using ev::TcpClient;
 using ev::TcpConnection;
 using ev::TcpConnectionPtr;
 using ev::TcpServer;
 using ev::ThreadPool;
+using ev::WriteCompleteCallback;
 
 using std::placeholders::_1;
 using std::placeholders::_2;
 using std::placeholders::_3;
 using std::placeholders::_4;
 
-using RpcDoneCallback = std::function<void(json::Value response)>;
+// 满足json::Writer要求的输出流, 直接写入ev::Buffer
+class BufferWriteStream : noncopyable {
+ public:
+  explicit BufferWriteStream(Buffer &buf) : buf_(buf) {}
+
+  void put(char c) { buf_.append(&c, 1); }
+  void put(std::string_view str) { buf_.append(str.data(), str.length()); }
+
+ private:
+  Buffer &buf_;
+};
+
+/* 交给RpcDoneCallback的response, 有四种形式:
+  - json::Value: 完整的response, 例如错误信息
+  - result: 成功的response只给出id和result, 外层的{"jsonrpc":"2.0",...}在序列化时直接写出,
+    不为其构造json::Value, 见UserDoneCallback
+  - body: typed codec的stub直接给出序列化好的JSON body
+  - batch: 按request顺序排列的各个response, 其中为null的项(notify)跳过, 序列化时直接写成array
+只在done的调用期间有效, 接收者需要立即序列化或用toValue()复制
+*/
+class RpcResponse {
+ public:
+  // 隐式转换, done(value)的写法不变
+  RpcResponse(const json::Value &value) : value_(&value) {}
+  RpcResponse(const json::Value &id, const json::Value &result)
+      : value_(&result), id_(&id) {}
+  explicit RpcResponse(std::string_view body) : body_(body) {}
+  RpcResponse(const json::Value *responses, size_t count)
+      : batch_(responses), batchSize_(count) {}
 
+  bool hasValue() const { return value_ != nullptr && id_ == nullptr; }
+  bool hasBatch() const { return batch_ != nullptr; }
+  bool hasResult() const { return id_ != nullptr; }
+  bool isNull() const { return hasValue() && value_->isNull(); }
+  const json::Value &value() const {
+    assert(hasValue());
+    return *value_;
+  }
+  const json::Value &id() const {
+    assert(hasResult());
+    return *id_;
+  }
+  const json::Value &result() const {
+    assert(hasResult());
+    return *value_;
+  }
+  std::string_view body() const { return body_; }
+  const json::Value *batch() const { return batch_; }
+  size_t batchSize() const { return batchSize_; }
+
+  // 构造完整的response, 只用于需要保存response的batch, 不支持body形式
+  json::Value toValue() const {
+    if (hasValue()) return *value_;
+    if (hasBatch()) {
+      json::Value responses(json::ValueType::TYPE_ARRAY);
+      for (size_t i = 0; i < batchSize_; i++) {
+        if (!batch_[i].isNull()) responses.addValue(batch_[i]);
+      }
+      return responses;
+    }
+    assert(hasResult());
+    json::Value response(json::ValueType::TYPE_OBJECT);
+    response.addMember("jsonrpc", "2.0");
+    response.addMember("id", *id_);
+    response.addMember("result", *value_);
+    return response;
+  }
+
+ private:
+  const json::Value *value_ = nullptr;
+  const json::Value *id_ = nullptr;
+  std::string_view body_;
+  const json::Value *batch_ = nullptr;
+  size_t batchSize_ = 0;
+};
+
+// 由BaseServer为每个request创建, 捕获的状态很小, 内联保存, 复制时不分配内存
+using RpcDoneCallback = InlineFunction<void(const RpcResponse &response)>;
+
+/* 交给用户procedure的完成回调, 用户调用callback(result)时构造response并发送
+只保存request的id、截止时间和连接的上下文(即RpcDoneCallback), 不复制整个request及其params
+RpcDoneCallback内联保存, 复制UserDoneCallback只增加其中的引用计数, 可以直接按值捕获到线程池的task中
+*/
 class UserDoneCallback {
  public:
   UserDoneCallback(json::Value &request, const RpcDoneCallback &callback)
-      : request_(request), callback_(callback) {}
+      : id_(request["id"]), callback_(callback) {}
+
+  // typed codec使用, rawId为request中id的原始JSON文本
+  UserDoneCallback(std::string_view rawId, const RpcDoneCallback &callback)
+      : rawId_(rawId), callback_(callback) {}
 
   void operator()(json::Value &&result) const {
-    json::Value response(json::ValueType::TYPE_OBJECT);
-    response.addMember("jsonrpc", "2.0");
-    response.addMember("id", request_["id"]);
-    response.addMember("result", result);
-    callback_(response);
+    if (!rawId_.empty()) {
+      writeTypedResponse(result);
+      return;
+    }
+    // 外层的response在序列化时直接写出, 不构造json::Value
+    callback_(RpcResponse(id_, result));
   }
 
+  // request的截止时间, request中没有timeout字段时has()为false
+  // method可以在开始耗时的处理之前检查expired(), 或者按remaining()缩短自己的等待
+  const Deadline &deadline() const { return deadline_; }
+
  private:
-  mutable json::Value request_;
+  // 成员顺序与上面构造的response相同, 只有result经过json::Writer
+  void writeTypedResponse(const json::Value &result) const {
+    thread_local Buffer buf;
+    buf.retrieveAll();
+    BufferWriteStream os(buf);
+    os.put(R"({"jsonrpc":"2.0","id":)");
+    os.put(rawId_);
+    os.put(R"(,"result":)");
+    json::Writer writer(os);
+    result.writeTo(writer);
+    os.put('}');
+    callback_(RpcResponse(std::string_view(buf.peek(), buf.readableBytes())));
+  }
+
+  // 二者只用其一: typed codec时rawId_非空(合法的JSON文本不为空), 否则为id_
+  json::Value id_;
+  std::string rawId_;
   RpcDoneCallback callback_;
+  Deadline deadline_ = Deadline::current();  // stub在调用method之前构造
 };
 
 }  // namespace rpc